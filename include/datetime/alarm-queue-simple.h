@@ -43,6 +43,11 @@ public:
     ~SimpleAlarmQueue();
     core::Signal<const Appointment&, const Alarm&>& alarm_reached() override;
 
+    // bookkeeping sizes, so callers can check that they stay bounded
+    size_t pending_count() const; // queued alarms, including stale ones
+    size_t alarm_count() const; // alarms in the planner's appointments
+    size_t triggered_count() const; // alarms remembered as already kicked
+
 private:
     class Impl;
     friend class Impl;
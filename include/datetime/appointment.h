@@ -22,6 +22,7 @@
 
 #include <datetime/date-time.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -68,6 +69,49 @@ public:
     bool operator== (const Appointment& that) const;
 };
 
+/**
+ * \brief An immutable, reference-counted list of Appointments
+ *
+ * Planners hand these out so that one engine result can be shared by every
+ * consumer instead of being copied into each one. It converts implicitly
+ * to and from std::vector<Appointment>, so it can be read like one.
+ *
+ * @see Planner
+ */
+class AppointmentList
+{
+public:
+    typedef std::vector<Appointment>::const_iterator const_iterator;
+    typedef const_iterator iterator;
+    typedef Appointment value_type;
+
+    AppointmentList();
+    AppointmentList(const std::vector<Appointment>& appointments);
+    AppointmentList(std::vector<Appointment>&& appointments);
+
+    const std::vector<Appointment>& get() const { return *m_snapshot; }
+    operator const std::vector<Appointment>&() const { return get(); }
+    const std::shared_ptr<const std::vector<Appointment>>& snapshot() const { return m_snapshot; }
+
+    const_iterator begin() const { return m_snapshot->begin(); }
+    const_iterator end() const { return m_snapshot->end(); }
+    size_t size() const { return m_snapshot->size(); }
+    bool empty() const { return m_snapshot->empty(); }
+    const Appointment& operator[](size_t i) const { return (*m_snapshot)[i]; }
+    const Appointment& front() const { return m_snapshot->front(); }
+    const Appointment& back() const { return m_snapshot->back(); }
+
+private:
+    std::shared_ptr<const std::vector<Appointment>> m_snapshot;
+};
+
+bool operator== (const AppointmentList& a, const AppointmentList& b);
+bool operator== (const AppointmentList& a, const std::vector<Appointment>& b);
+bool operator== (const std::vector<Appointment>& a, const AppointmentList& b);
+bool operator!= (const AppointmentList& a, const AppointmentList& b);
+bool operator!= (const AppointmentList& a, const std::vector<Appointment>& b);
+bool operator!= (const std::vector<Appointment>& a, const AppointmentList& b);
+
 } // namespace datetime
 } // namespace indicator
 } // namespace unity
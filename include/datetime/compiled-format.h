@@ -0,0 +1,94 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_COMPILED_FORMAT_H
+#define INDICATOR_DATETIME_COMPILED_FORMAT_H
+
+#include <datetime/date-time.h>
+
+#include <cstdint> // int64_t
+#include <string>
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+/**
+ * \brief A strftime-style format string that's parsed once
+ *
+ * The format is split into literal text and conversion fields. Each
+ * format() call only rerenders the fields whose inputs changed since the
+ * last call (eg, just the seconds), and writes them into a buffer that's
+ * reused from one call to the next.
+ *
+ * Conversions that glib supports but that aren't handled here are passed
+ * along to g_date_time_format() one field at a time.
+ *
+ * Names and abbreviations depend on more than the fields' values, so
+ * everything is rerendered when the LC_TIME locale or timezone changes.
+ */
+class CompiledFormat
+{
+public:
+    explicit CompiledFormat(const std::string& fmt="");
+
+    const std::string& source() const { return m_source; }
+
+    /** \brief True if the formatted string changes every second */
+    bool shows_seconds() const { return m_shows_seconds; }
+
+    /** \brief Formats dt. The result is valid until the next call. */
+    const std::string& format(const DateTime& dt);
+
+private:
+    struct Op
+    {
+        char conversion; // 0 for literal text
+        std::string spec; // what to pass to g_date_time_format()
+        int64_t key;     // the input that the text was rendered from
+        bool rendered;
+        std::string text;
+        size_t offset;   // where the text is in m_buffer
+    };
+
+    static int64_t key_of(const Op&, GDateTime*);
+    static void render(Op&, GDateTime*);
+
+    std::string m_source;
+    std::vector<Op> m_ops;
+    std::string m_buffer;
+    bool m_shows_seconds = false;
+    std::string m_locale; // what the fields were rendered in
+    GTimeZone* m_timezone = nullptr;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_COMPILED_FORMAT_H
@@ -22,9 +22,11 @@
 
 #include <glib.h> // GDateTime
 
+#include <atomic>
 #include <chrono>
 #include <ctime> // time_t
-#include <memory> // std::shared_ptr
+#include <memory>
+#include <string>
 
 namespace unity {
 namespace indicator {
@@ -32,11 +34,19 @@ namespace datetime {
 
 /**
  * \brief A simple C++ wrapper for GDateTime to simplify ownership/refcounts
+ *
+ * To keep it cheap to copy, sort, and compare, a DateTime is stored as a
+ * microsecond instant plus an interned timezone. The GDateTime is only
+ * built when get() (or something that needs the calendar) is called.
+ *
+ * Like the standard containers, const methods (including get()) can be
+ * called from several threads at once; modifying one can't.
  */
 class DateTime
 {
 public:
     static DateTime NowLocal();
+    static DateTime Now(GTimeZone*);
     static DateTime Local(time_t);
     static DateTime Local(int year, int month, int day, int hour, int minute, double seconds);
 
@@ -44,7 +54,11 @@ public:
     DateTime(GTimeZone* tz, time_t t);
     DateTime(GTimeZone* tz, GDateTime* dt);
     DateTime(GTimeZone* tz, int year, int month, int day, int hour, int minute, double seconds);
+    DateTime(const DateTime& in);
+    DateTime(DateTime&& in);
+    ~DateTime();
     DateTime& operator=(const DateTime& in);
+    DateTime& operator=(DateTime&& in);
     DateTime& operator+=(const std::chrono::minutes&);
     DateTime& operator+=(const std::chrono::seconds&);
     DateTime to_timezone(const std::string& zone) const;
@@ -66,6 +80,14 @@ public:
     int minute() const;
     double seconds() const;
     int64_t to_unix() const;
+    int64_t to_usec() const { return m_usec; }
+
+    GTimeZone* timezone() const { return m_tz; } // interned, so it can be compared by address
+
+    // these only need the timezone, not the calendar
+    GTimeSpan utc_offset() const;
+    int64_t day_number() const; // days since the epoch in this timezone
+    const char* timezone_abbreviation() const;
 
     bool operator<(const DateTime& that) const;
     bool operator>(const DateTime& that) const;
@@ -78,12 +100,18 @@ public:
     static bool is_same_day(const DateTime& a, const DateTime& b);
     static bool is_same_minute(const DateTime& a, const DateTime& b);
 
-    bool is_set() const { return m_tz && m_dt; }
+    bool is_set() const { return m_tz != nullptr; }
 
 private:
+    static DateTime from_instant(GTimeZone* interned_tz, GTimeSpan usec);
+    static GTimeZone* intern(GTimeZone*);
+    int interval() const;
     void reset(GTimeZone*, GDateTime*);
-    std::shared_ptr<GTimeZone> m_tz;
-    std::shared_ptr<GDateTime> m_dt;
+    static GDateTime* ref_or_null(GDateTime*);
+    void replace_dt(GDateTime*);
+    GTimeSpan m_usec = 0;       // microseconds since the Unix epoch
+    GTimeZone* m_tz = nullptr;  // interned, so never freed
+    mutable std::atomic<GDateTime*> m_dt {nullptr}; // built on demand by get()
 };
 
 } // namespace datetime
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_ENGINE_CACHE_H
+#define INDICATOR_DATETIME_ENGINE_CACHE_H
+
+#include <datetime/engine.h>
+
+#include <memory> // std::shared_ptr, std::unique_ptr
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/****
+*****
+****/
+
+/**
+ * \brief An #Engine that caches another Engine's appointments.
+ *
+ * Several planners often ask for overlapping date ranges, such as
+ * the calendar month and the upcoming month. CacheEngine remembers which
+ * intervals it has already fetched and only asks the wrapped Engine for
+ * the gaps, so the overlapping parts are served from memory.
+ *
+ * The cache is flushed whenever the wrapped Engine emits changed().
+ *
+ * @see Engine
+ */
+class CacheEngine: public Engine
+{
+public:
+    explicit CacheEngine(const std::shared_ptr<Engine>& engine);
+    ~CacheEngine();
+
+    void get_appointments(const DateTime& begin,
+                          const DateTime& end,
+                          const Timezone& default_timezone,
+                          std::function<void(const std::vector<Appointment>&)> appointment_func,
+                          GCancellable* cancellable) override;
+    void stream_appointments(const DateTime& begin,
+                             const DateTime& end,
+                             const Timezone& default_timezone,
+                             std::function<void(const std::vector<Appointment>&, bool done)> batch_func,
+                             GCancellable* cancellable) override;
+    void disable_ubuntu_alarm(const Appointment&) override;
+    void watch_range(const void* key, const DateTime& begin, const DateTime& end) override;
+    void unwatch_range(const void* key) override;
+
+    core::Signal<>& changed() override;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> p;
+
+    // we've got a unique_ptr here, disable copying...
+    CacheEngine(const CacheEngine&) =delete;
+    CacheEngine& operator=(const CacheEngine&) =delete;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_ENGINE_CACHE_H
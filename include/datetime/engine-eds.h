@@ -52,8 +52,16 @@ public:
     void get_appointments(const DateTime& begin,
                           const DateTime& end,
                           const Timezone& default_timezone,
-                          std::function<void(const std::vector<Appointment>&)> appointment_func) override;
+                          std::function<void(const std::vector<Appointment>&)> appointment_func,
+                          GCancellable* cancellable) override;
+    void stream_appointments(const DateTime& begin,
+                             const DateTime& end,
+                             const Timezone& default_timezone,
+                             std::function<void(const std::vector<Appointment>&, bool done)> batch_func,
+                             GCancellable* cancellable) override;
     void disable_ubuntu_alarm(const Appointment&) override;
+    void watch_range(const void* key, const DateTime& begin, const DateTime& end) override;
+    void unwatch_range(const void* key) override;
 
     core::Signal<>& changed() override;
 
@@ -44,8 +44,10 @@ public:
     void get_appointments(const DateTime& /*begin*/,
                           const DateTime& /*end*/,
                           const Timezone& /*default_timezone*/,
-                          std::function<void(const std::vector<Appointment>&)> appointment_func) override {
-        appointment_func(m_appointments);
+                          std::function<void(const std::vector<Appointment>&)> appointment_func,
+                          GCancellable* cancellable) override {
+        if (!g_cancellable_is_cancelled(cancellable))
+            appointment_func(m_appointments);
     }
 
     core::Signal<>& changed() override {
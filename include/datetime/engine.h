@@ -24,6 +24,8 @@
 #include <datetime/date-time.h>
 #include <datetime/timezone.h>
 
+#include <gio/gio.h> // GCancellable
+
 #include <functional>
 #include <vector>
 
@@ -46,12 +48,50 @@ class Engine
 public:
     virtual ~Engine() =default;
 
+    /**
+     * Asynchronously gets the appointments in [begin..end].
+     *
+     * If the optional cancellable is cancelled before the request finishes,
+     * the engine abandons the work and appointment_func is not called.
+     */
     virtual void get_appointments(const DateTime& begin,
                                   const DateTime& end,
                                   const Timezone& default_timezone,
-                                  std::function<void(const std::vector<Appointment>&)> appointment_func) =0;
+                                  std::function<void(const std::vector<Appointment>&)> appointment_func,
+                                  GCancellable* cancellable) =0;
+
+    /**
+     * Like get_appointments(), but delivers the results as they arrive.
+     *
+     * batch_func is called with each backend source's appointments as soon
+     * as that source is ready, with done=false, and then one last time with
+     * done=true and the complete, sorted list.
+     *
+     * The default implementation just waits for get_appointments().
+     */
+    virtual void stream_appointments(const DateTime& begin,
+                                     const DateTime& end,
+                                     const Timezone& default_timezone,
+                                     std::function<void(const std::vector<Appointment>&, bool done)> batch_func,
+                                     GCancellable* cancellable)
+    {
+        get_appointments(begin, end, default_timezone, [batch_func](const std::vector<Appointment>& appointments){
+            batch_func(appointments, true);
+        }, cancellable);
+    }
+
     virtual void disable_ubuntu_alarm(const Appointment&) =0;
 
+    /**
+     * Tells the engine which range a caller is currently interested in.
+     * Calling this again with the same key replaces that caller's range.
+     *
+     * This is only a hint: engines may choose to ignore changes that fall
+     * outside of every watched range.
+     */
+    virtual void watch_range(const void* /*key*/, const DateTime& /*begin*/, const DateTime& /*end*/) {}
+    virtual void unwatch_range(const void* /*key*/) {}
+
     virtual core::Signal<>& changed() =0;
 
 protected:
@@ -85,6 +85,10 @@ public:
                starting at the end of the current clock's day yields "Tomorrow" */
     std::string relative_format(GDateTime* then, GDateTime* then_end=nullptr) const;
 
+    /** \brief Like the GDateTime version, but doesn't need to build any GDateTimes */
+    std::string relative_format(const DateTime& then) const;
+    std::string relative_format(const DateTime& then, const DateTime& then_end) const;
+
 protected:
     explicit Formatter(const std::shared_ptr<const Clock>&);
     virtual ~Formatter();
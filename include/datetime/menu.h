@@ -22,8 +22,11 @@
 
 #include <datetime/actions.h>
 #include <datetime/appointment.h>
+#include <datetime/formatter.h>
 #include <datetime/state.h>
 
+#include <core/property.h>
+
 #include <memory> // std::shared_ptr
 #include <vector>
 
@@ -48,6 +51,17 @@ public:
     Profile profile() const;
     GMenuModel* menu_model();
 
+    /** \brief True if anyone is watching the exported menu_model().
+               While it's false, the menu doesn't rebuild itself; it just
+               remembers what's stale and catches up when it's watched again.
+               Menus start out watched; the Exporter tracks it from then on. */
+    core::Property<bool> subscribed;
+
+    /** \brief How many section/header rebuilds have been asked for,
+               and how many actually ran after coalescing */
+    unsigned int rebuilds_requested() const;
+    unsigned int rebuilds_executed() const;
+
     static std::vector<Appointment> get_display_appointments(
         const std::vector<Appointment>&,
         const DateTime& start,
@@ -57,6 +71,8 @@ protected:
     Menu (Profile profile_in, const std::string& name_in);
     virtual ~Menu() =default;
     GMenu* m_menu = nullptr;
+    unsigned int m_rebuilds_requested = 0;
+    unsigned int m_rebuilds_executed = 0;
 
 private:
     const Profile m_profile;
@@ -80,8 +96,13 @@ public:
     std::shared_ptr<Menu> buildMenu(Menu::Profile profile);
 
 private:
+    std::shared_ptr<const Formatter> desktop_formatter();
+    std::shared_ptr<const Formatter> phone_formatter();
+
     std::shared_ptr<Actions> m_actions;
     std::shared_ptr<const State> m_state;
+    std::shared_ptr<const Formatter> m_desktop_formatter;
+    std::shared_ptr<const Formatter> m_phone_formatter;
 };
 
 } // namespace datetime
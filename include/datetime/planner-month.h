@@ -25,7 +25,13 @@
 #include <datetime/date-time.h>
 #include <datetime/planner-range.h>
 
+#include <array>
+#include <cstdint> // int64_t
+#include <map>
 #include <memory> // std::shared_ptr
+#include <string>
+#include <utility> // std::pair
+#include <vector>
 
 namespace unity {
 namespace indicator {
@@ -41,12 +47,36 @@ public:
                  const DateTime& month_in);
     ~MonthPlanner() =default;
 
-    core::Property<std::vector<Appointment>>& appointments();
+    core::Property<AppointmentList>& appointments();
     core::Property<DateTime>& month();
 
+    /**
+     * \brief The days of month() that have appointments, in ascending order.
+     *
+     * Multi-day appointments mark every day they cover. This is kept
+     * up to date from deltas() rather than by walking appointments().
+     */
+    core::Property<std::vector<int>>& appointment_days();
+
 private:
+    struct Days { int64_t first; int64_t last; }; // day numbers, inclusive
+    typedef std::pair<std::string,int64_t> InstanceKey; // uid, begin
+
+    static Days days_of(const Appointment&);
+    void add(const Appointment&);
+    void remove(const Appointment&, bool match_days);
+    void count(const Days&, int n);
+    void recount();
+    void update_appointment_days();
+
     std::shared_ptr<RangePlanner> m_range_planner;
     core::Property<DateTime> m_month;
+    core::Property<std::vector<int>> m_appointment_days;
+
+    std::map<InstanceKey,std::vector<Days>> m_days; // the days each instance covers
+    std::array<int,32> m_day_counts; // appointments per day of m_month; [0] is unused
+    int64_t m_month_first_day = 0; // day number of the 1st of m_month
+    int64_t m_month_last_day = -1; // day number of the last day of m_month
 };
 
 } // namespace datetime
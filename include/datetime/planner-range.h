@@ -56,20 +56,29 @@ public:
                        const std::shared_ptr<Timezone>& timezone);
     virtual ~SimpleRangePlanner();
 
-    core::Property<std::vector<Appointment>>& appointments();
+    core::Property<AppointmentList>& appointments();
     core::Property<std::pair<DateTime,DateTime>>& range();
 
 private:
     // rebuild scaffolding
     void rebuild_soon();
     virtual void rebuild_now();
-    static gboolean rebuild_now_static(gpointer);
     guint m_rebuild_tag = 0;
 
+    // each rebuild supersedes the previous one, so cancel the old request
+    void cancel_request();
+    unsigned int m_generation = 0;
+    GCancellable* m_cancellable = nullptr;
+
+    // show the engine's partial results while waiting for the rest
+    static std::vector<Appointment> merge_partial(const std::vector<Appointment>& received,
+                                                  const std::vector<Appointment>& previous,
+                                                  const std::pair<DateTime,DateTime>& range);
+
     std::shared_ptr<Engine> m_engine;
     std::shared_ptr<Timezone> m_timezone;
     core::Property<std::pair<DateTime,DateTime>> m_range;
-    core::Property<std::vector<Appointment>> m_appointments;
+    core::Property<AppointmentList> m_appointments;
 
     // we've got a GSignal tag here, so disable copying
     explicit SimpleRangePlanner(const RangePlanner&) =delete;
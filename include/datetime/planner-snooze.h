@@ -39,7 +39,7 @@ public:
     SnoozePlanner(const std::shared_ptr<Settings>&,
                   const std::shared_ptr<Clock>&);
     ~SnoozePlanner();
-    core::Property<std::vector<Appointment>>& appointments() override;
+    core::Property<AppointmentList>& appointments() override;
     void add(const Appointment&, const Alarm&);
 
 protected:
@@ -41,7 +41,7 @@ public:
                     const DateTime& date);
     ~UpcomingPlanner() =default;
 
-    core::Property<std::vector<Appointment>>& appointments();
+    core::Property<AppointmentList>& appointments();
     core::Property<DateTime>& date();
 
 private:
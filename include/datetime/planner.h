@@ -25,12 +25,29 @@
 
 #include <core/property.h>
 
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace unity {
 namespace indicator {
 namespace datetime {
 
+/**
+ * \brief What changed between two versions of a Planner's appointments.
+ *
+ * Appointments are matched by their uid and instance begin time.
+ */
+struct AppointmentDelta
+{
+    std::vector<Appointment> added;
+    std::vector<Appointment> removed;
+    std::vector<Appointment> changed; // the new versions
+
+    bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+};
+
 /**
  * \brief Simple collection of appointments
  */
@@ -38,11 +55,37 @@ class Planner
 {
 public:
     virtual ~Planner();
-    virtual core::Property<std::vector<Appointment>>& appointments() =0;
+    virtual core::Property<AppointmentList>& appointments() =0;
+
+    /**
+     * Looks up an appointment by its uid without walking the list.
+     * If several instances share the uid, the earliest one is used.
+     */
+    bool find_appointment(const std::string& uid, Appointment& setme);
+
+    /**
+     * Emitted after appointments() changes, with just what changed,
+     * so that listeners can do work in proportion to the change.
+     */
+    core::Signal<const AppointmentDelta&>& deltas();
+
+    static AppointmentDelta diff(const std::vector<Appointment>& before,
+                                 const std::vector<Appointment>& after);
 
 protected:
     Planner();
     static void sort(std::vector<Appointment>&);
+
+private:
+    // the last list we diffed against; tracked once someone wants deltas()
+    core::Signal<const AppointmentDelta&> m_deltas;
+    AppointmentList m_previous;
+    std::unique_ptr<core::ScopedConnection> m_deltas_connection;
+
+    // uid -> position in appointments(), rebuilt lazily after it changes
+    std::unordered_map<std::string,size_t> m_uid_index;
+    std::unique_ptr<core::ScopedConnection> m_uid_index_connection;
+    bool m_uid_index_dirty = true;
 };
 
 } // namespace datetime
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_SNAPSHOT_H
+#define INDICATOR_DATETIME_SNAPSHOT_H
+
+#include <datetime/appointment.h>
+#include <datetime/date-time.h>
+#include <datetime/state.h>
+
+#include <memory> // std::shared_ptr, std::unique_ptr
+#include <string>
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+/**
+ * \brief Keeps an on-disk copy of the appointments shown in the menu.
+ *
+ * EDS can take seconds to start after login. Until it does, the menu
+ * is populated from the previous session's snapshot, which is a small
+ * versioned file that is mmap()ed at startup. The planners' own results
+ * replace the snapshot's as soon as EDS answers.
+ */
+class Snapshot
+{
+public:
+    explicit Snapshot(const std::string& filename);
+    ~Snapshot();
+
+    /** \brief Seeds the state's planners from the snapshot,
+               then rewrites the snapshot whenever they change */
+    void track(const std::shared_ptr<State>& state);
+
+    /** \brief Loads the upcoming appointments that haven't ended by 'now',
+               and the month appointments if they're for the same month */
+    bool load(const DateTime& now,
+              std::vector<Appointment>& upcoming,
+              std::vector<Appointment>& month) const;
+
+    void save(const DateTime& month_begin,
+              const std::vector<Appointment>& upcoming,
+              const std::vector<Appointment>& month) const;
+
+    static std::string default_filename();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> p;
+
+    // we've got a unique_ptr here, disable copying...
+    Snapshot(const Snapshot&) =delete;
+    Snapshot& operator=(const Snapshot&) =delete;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_SNAPSHOT_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_TIMER_SERVICE_H
+#define INDICATOR_DATETIME_TIMER_SERVICE_H
+
+#include <glib.h> // GTimeSpan, guint
+
+#include <core/signal.h>
+
+#include <cstdint> // uint64_t
+#include <functional>
+#include <memory> // std::unique_ptr
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+/**
+ * \brief One timerfd that the whole service's timers share.
+ *
+ * Each timer has a deadline and a tolerance: it may kick at any time
+ * in [deadline..deadline+tolerance]. Timers whose windows overlap are
+ * kicked together by a single wakeup, so most of the service's timers
+ * ride along with the minute tick instead of waking the device on
+ * their own.
+ *
+ * Tags work like GSource tags: 0 means no timer.
+ */
+class TimerService
+{
+public:
+    typedef std::function<void()> Func;
+
+    /** \brief The service's shared TimerService */
+    static TimerService& get_default();
+
+    TimerService();
+    ~TimerService();
+
+    /**
+     * \brief Calls func once, in the given window after delay_usec.
+     *
+     * The delay follows monotonic time, so setting the wall clock
+     * doesn't make it kick early or late.
+     */
+    guint add(GTimeSpan delay_usec, GTimeSpan tolerance_usec, Func func);
+
+    /**
+     * \brief Calls func once, in the given window after a wall-clock
+     * time in microseconds since the epoch, e.g. from g_get_real_time().
+     */
+    guint add_at(GTimeSpan deadline_usec, GTimeSpan tolerance_usec, Func func);
+
+    /** \brief Cancels the timer, if any, and zeroes the tag */
+    void remove(guint& tag);
+
+    /** \brief Emitted when someone sets the wall clock */
+    core::Signal<>& clock_set();
+
+    /** \brief How many times the timerfd has woken the service */
+    uint64_t wakeup_count() const;
+
+    /** \brief wakeup_count() averaged over the service's uptime */
+    double wakeups_per_hour() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> p;
+
+    TimerService(const TimerService&) =delete;
+    TimerService& operator=(const TimerService&) =delete;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_TIMER_SERVICE_H
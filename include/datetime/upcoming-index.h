@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_UPCOMING_INDEX_H
+#define INDICATOR_DATETIME_UPCOMING_INDEX_H
+
+#include <datetime/appointment.h>
+#include <datetime/date-time.h>
+
+#include <memory> // std::shared_ptr
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+/**
+ * \brief Picks which of the upcoming appointments the menu should show
+ *
+ * Keeps the appointments ordered by begin time, with a cursor separating
+ * the ones that have started from the ones that haven't, and a min-end
+ * heap of the started ones so that they're dropped as they expire.
+ * As long as the list and the time only move forward, each call costs
+ * O(K log n) for K items rather than a sort of the whole list.
+ *
+ * @see Menu::get_display_appointments()
+ */
+class UpcomingIndex
+{
+public:
+    UpcomingIndex() =default;
+
+    /** \brief Sets the appointments to choose from.
+               Cheap if it's the same snapshot as last time. */
+    void set(const AppointmentList& appointments);
+
+    /** \brief Returns up to max_items appointments that end at or after
+               'now', chosen and ordered as Menu::get_display_appointments()
+               describes */
+    std::vector<Appointment> get_display_appointments(const DateTime& now,
+                                                      unsigned int max_items);
+
+private:
+    void reset();
+    void advance(const DateTime& now, const DateTime& next_minute);
+
+    std::shared_ptr<const std::vector<Appointment>> m_snapshot;
+    std::vector<const Appointment*> m_by_begin; // m_snapshot sorted by begin
+    size_t m_cursor = 0; // m_by_begin[0..m_cursor) have started
+    std::vector<const Appointment*> m_started; // min-end heap
+    DateTime m_now; // the last 'now' we advanced to
+
+    // the heap and cursor point into m_snapshot, so disable copying
+    UpcomingIndex(const UpcomingIndex&) =delete;
+    UpcomingIndex& operator=(const UpcomingIndex&) =delete;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_UPCOMING_INDEX_H
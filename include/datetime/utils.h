@@ -39,6 +39,16 @@ gchar *       get_timezone_name                    (const char  * timezone,
 gchar *       get_beautified_timezone_name         (const char  * timezone,
                                                     const char  * saved_location);
 
+/** \brief Returns the strftime(3) format for showing 'then' relative to 'now'.
+           The day arguments are day numbers (eg, days since the epoch), each
+           counted in that time's own timezone. The string is cached, so
+           it must not be freed. */
+const char*   get_relative_format_string           (gint64        now_usec,
+                                                    gint64        now_day,
+                                                    gint64        then_usec,
+                                                    gint64        then_day,
+                                                    gboolean      full_day);
+
 gchar *       generate_full_format_string_at_time  (GDateTime   * now,
                                                     GDateTime   * then_begin,
                                                     GDateTime   * then_end);
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_WAKEUP_TIMER_TIMERFD_H
+#define INDICATOR_DATETIME_WAKEUP_TIMER_TIMERFD_H
+
+#include <datetime/clock.h>
+#include <datetime/wakeup-timer.h>
+
+#include <memory> // std::unique_ptr, std::shared_ptr
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+/**
+ * \brief a WakeupTimer that kicks at the exact wakeup time.
+ *
+ * This registers an absolute deadline with the TimerService's
+ * CLOCK_REALTIME timerfd, so it fires within milliseconds of the wakeup
+ * time and follows wall-clock changes, instead of computing a relative
+ * g_timeout_add() interval.
+ *
+ * If a hardware timer is given, it's armed for the same time so that
+ * a suspended device still wakes up, and its timeouts are passed along.
+ */
+class TimerfdWakeupTimer: public WakeupTimer
+{
+public:
+    explicit TimerfdWakeupTimer(const std::shared_ptr<Clock>&,
+                                const std::shared_ptr<WakeupTimer>& hardware_timer = std::shared_ptr<WakeupTimer>());
+    ~TimerfdWakeupTimer();
+    void set_wakeup_time (const DateTime&) override;
+    core::Signal<>& timeout() override;
+
+private:
+    TimerfdWakeupTimer(const TimerfdWakeupTimer&) =delete;
+    TimerfdWakeupTimer& operator= (const TimerfdWakeupTimer&) =delete;
+    class Impl;
+    std::unique_ptr<Impl> p;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_WAKEUP_TIMER_TIMERFD_H
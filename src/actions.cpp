@@ -50,16 +50,7 @@ DateTime datetime_from_timet_variant(GVariant* v)
 
 bool lookup_appointment_by_uid(const std::shared_ptr<State>& state, const gchar* uid, Appointment& setme)
 {
-    for(const auto& appt : state->calendar_upcoming->appointments().get())
-    {
-        if (appt.uid == uid)
-        {
-            setme = appt;
-            return true;
-        }
-    }
-
-    return false;
+    return (uid != nullptr) && state->calendar_upcoming->find_appointment(uid, setme);
 }
 
 void on_appointment_activated (GSimpleAction*, GVariant *vdata, gpointer gself)
@@ -137,15 +128,10 @@ GVariant* create_default_header_state()
 
 GVariant* create_calendar_state(const std::shared_ptr<State>& state)
 {
-    gboolean days[32] = { 0 };
-    for (const auto& appt : state->calendar_month->appointments().get())
-        days[appt.begin.day_of_month()] = true;
-
     GVariantBuilder day_builder;
     g_variant_builder_init(&day_builder, G_VARIANT_TYPE("ai"));
-    for (guint i=0; i<G_N_ELEMENTS(days); i++)
-        if (days[i])
-            g_variant_builder_add(&day_builder, "i", i);
+    for (const auto day : state->calendar_month->appointment_days().get())
+        g_variant_builder_add(&day_builder, "i", day);
 
     GVariantBuilder dict_builder;
     g_variant_builder_init(&dict_builder, G_VARIANT_TYPE_DICTIONARY);
@@ -228,7 +214,7 @@ Actions::Actions(const std::shared_ptr<State>& state):
     m_state->calendar_month->month().changed().connect([this](const DateTime&){
         update_calendar_state();
     });
-    m_state->calendar_month->appointments().changed().connect([this](const std::vector<Appointment>&){
+    m_state->calendar_month->appointment_days().changed().connect([this](const std::vector<int>&){
         update_calendar_state();
     });
     m_state->settings->show_week_numbers.changed().connect([this](bool){
@@ -19,7 +19,9 @@
 
 #include <datetime/alarm-queue-simple.h>
 
+#include <algorithm> // std::push_heap(), std::pop_heap()
 #include <cmath>
+#include <map>
 #include <set>
 
 namespace unity {
@@ -42,9 +44,10 @@ public:
       m_timer{timer},
       m_datetime{clock->localtime()}
     {
-        m_planner->appointments().changed().connect([this](const std::vector<Appointment>&){
-            g_debug("AlarmQueue %p calling requeue() due to appointments changed", this);
-            requeue();
+        m_planner->deltas().connect([this](const AppointmentDelta& delta){
+            g_debug("AlarmQueue %p updating for %zu added, %zu changed, %zu removed appointments",
+                    this, delta.added.size(), delta.changed.size(), delta.removed.size());
+            update(delta);
         });
 
         m_clock->minute_changed.connect([this]{
@@ -59,8 +62,9 @@ public:
         });
 
         m_timer->timeout().connect([this](){
-            g_debug("AlarmQueue %p calling requeue() due to timeout", this);
-            requeue();
+            g_debug("AlarmQueue %p calling process() due to timeout", this);
+            m_wakeup_time = DateTime(); // rearm even if we woke up a little early
+            process();
         });
 
         requeue();
@@ -75,88 +79,213 @@ public:
         return m_alarm_reached;
     }
 
+    size_t pending_count() const { return m_pending.size(); }
+    size_t alarm_count() const { return m_n_alarms; }
+    size_t triggered_count() const { return m_triggered.size(); }
+
 private:
 
-    void requeue()
+    // appointments are matched by uid and instance begin time, as in Planner::diff()
+    typedef std::pair<std::string,int64_t> Key;
+
+    static Key key_of(const Appointment& appointment)
     {
-        const auto appointments = m_planner->appointments().get();
-        const Alarm* alarm;
+        return Key{appointment.uid, appointment.begin.to_unix()};
+    }
 
-        // kick any current alarms
-        for (const auto& appointment : appointments)
-        {
-            if ((alarm = appointment_get_current_alarm(appointment)))
-            {
-                m_triggered.insert(std::make_pair(appointment.uid, alarm->time));
-                m_alarm_reached(appointment, *alarm);
-            }
-        }
+    // one alarm waiting in m_pending
+    struct Pending
+    {
+        DateTime time;
+        uint64_t seq; // breaks ties in the planner's order
+        std::shared_ptr<const Appointment> appointment;
+        size_t alarm; // index into appointment->alarms
 
-        // idle until the next alarm
-        if ((alarm = find_next_alarm(appointments)))
+        // std::*_heap() keep the largest on top, so invert the order
+        bool operator<(const Pending& that) const
         {
-            g_debug ("setting timer to wake up for next appointment '%s' at %s", 
-                     alarm->text.c_str(),
-                     alarm->time.format("%F %T").c_str());
+            if (time != that.time)
+                return that.time < time;
+            return that.seq < seq;
+        }
+    };
 
-            m_timer->set_wakeup_time(alarm->time);
+    // rebuild from scratch
+    void requeue()
+    {
+        m_appointments.clear();
+        m_pending.clear();
+        m_n_alarms = 0;
+        m_wakeup_time = DateTime();
+        for (const auto& appointment : m_planner->appointments().get())
+            add(appointment);
+        std::make_heap(m_pending.begin(), m_pending.end());
+
+        // forget the alarms that have already passed and left the planner
+        std::set<std::pair<std::string,DateTime>> known;
+        for (const auto& it : m_appointments)
+            for (const auto& alarm : it.second->alarms)
+                known.insert(std::make_pair(it.second->uid, alarm.time));
+        const auto beginning_of_minute = m_clock->localtime().start_of_minute();
+        for (auto it=m_triggered.begin(); it!=m_triggered.end(); ) {
+            if ((it->second < beginning_of_minute) && !known.count(*it))
+                it = m_triggered.erase(it);
+            else
+                ++it;
         }
+
+        process();
     }
 
-    bool already_triggered (const Appointment& appt, const Alarm& alarm) const
+    // like requeue(), but only touches the appointments that changed
+    void update(const AppointmentDelta& delta)
     {
-        const std::pair<const std::string&,const DateTime&> key{appt.uid, alarm.time};
-        return m_triggered.count(key) != 0;
+        const auto beginning_of_minute = m_clock->localtime().start_of_minute();
+
+        // the heap entries of removed or changed appointments go stale
+        // and are dropped when they reach the top, so cancelling is cheap
+        for (const auto& appointment : delta.removed)
+        {
+            remove(appointment);
+
+            // once an alarm has passed and left the planner, it can't recur
+            for (const auto& alarm : appointment.alarms)
+                if (alarm.time < beginning_of_minute)
+                    m_triggered.erase(std::make_pair(appointment.uid, alarm.time));
+        }
+
+        for (const auto& appointments : {&delta.changed, &delta.added})
+        {
+            for (const auto& appointment : *appointments)
+            {
+                const auto n = m_pending.size();
+                add(appointment);
+                for (auto i=n+1, end=m_pending.size(); i<=end; ++i)
+                    std::push_heap(m_pending.begin(), m_pending.begin()+i);
+            }
+        }
+
+        // don't let stale entries pile up
+        if (m_pending.size() > 64 && m_pending.size() > 2*m_n_alarms)
+            compact();
+
+        process();
     }
 
-    // return the next Alarm (if any) that will kick now or in the future
-    const Alarm* find_next_alarm(const std::vector<Appointment>& appointments) const
+    // kick any current alarms, then idle until the next one
+    void process()
     {
-        const Alarm* best {};
         const auto now = m_clock->localtime();
         const auto beginning_of_minute = now.start_of_minute();
 
-        g_debug ("planner has %zu appointments in it", (size_t)appointments.size());
-
-        for(const auto& appointment : appointments)
+        while (!m_pending.empty())
         {
-            for(const auto& alarm : appointment.alarms)
+            const auto& top = m_pending.front();
+
+            if (!is_live(top) || (top.time < beginning_of_minute)) // stale or already passed
             {
-                if (already_triggered(appointment, alarm))
-                    continue;
+                pop();
+                continue;
+            }
 
-                if (alarm.time < beginning_of_minute) // has this one already passed?
-                    continue;
+            if (now < top.time) // not due yet
+                break;
 
-                if (best && (best->time < alarm.time)) // do we already have a better match?
-                    continue;
+            const auto appointment = top.appointment;
+            const auto& alarm = appointment->alarms[top.alarm];
+            pop();
 
-                best = &alarm;
+            const auto triggered = std::make_pair(appointment->uid, alarm.time);
+            if (!m_triggered.count(triggered))
+            {
+                m_triggered.insert(triggered);
+                m_alarm_reached(*appointment, alarm);
             }
         }
 
-        return best;
+        if (!m_pending.empty())
+        {
+            const auto& next = m_pending.front();
+            if (next.time != m_wakeup_time)
+                set_wakeup(next.appointment->alarms[next.alarm]);
+        }
+    }
+
+    void add(const Appointment& appointment)
+    {
+        const auto beginning_of_minute = m_clock->localtime().start_of_minute();
+
+        remove(appointment);
+        std::shared_ptr<const Appointment> ptr {new Appointment(appointment)};
+        m_appointments[key_of(appointment)] = ptr;
+        m_n_alarms += appointment.alarms.size();
+
+        for (size_t i=0, n=appointment.alarms.size(); i<n; ++i)
+        {
+            const auto& alarm = appointment.alarms[i];
+            if (alarm.time < beginning_of_minute) // has this one already passed?
+                continue;
+            if (m_triggered.count(std::make_pair(appointment.uid, alarm.time)))
+                continue;
+            m_pending.push_back(Pending{alarm.time, m_seq++, ptr, i});
+        }
     }
 
-    // return the Appointment's current Alarm (if any)
-    const Alarm* appointment_get_current_alarm(const Appointment& appointment) const
+    void remove(const Appointment& appointment)
     {
-        const auto now = m_clock->localtime();
+        auto it = m_appointments.find(key_of(appointment));
+        if (it != m_appointments.end())
+        {
+            m_n_alarms -= it->second->alarms.size();
+            m_appointments.erase(it);
+        }
+    }
+
+    bool is_live(const Pending& pending) const
+    {
+        auto it = m_appointments.find(key_of(*pending.appointment));
+        return (it != m_appointments.end()) && (it->second == pending.appointment);
+    }
+
+    void pop()
+    {
+        std::pop_heap(m_pending.begin(), m_pending.end());
+        m_pending.pop_back();
+    }
+
+    void compact()
+    {
+        std::vector<Pending> live;
+        live.reserve(m_n_alarms);
+        for (auto& pending : m_pending)
+            if (is_live(pending))
+                live.push_back(std::move(pending));
+        std::make_heap(live.begin(), live.end());
+        m_pending.swap(live);
+    }
 
-        for (const auto& alarm : appointment.alarms)
-            if (!already_triggered(appointment, alarm) && DateTime::is_same_minute(now, alarm.time))
-                return &alarm;
+    void set_wakeup(const Alarm& alarm)
+    {
+        g_debug ("setting timer to wake up for next appointment '%s' at %s",
+                 alarm.text.c_str(),
+                 alarm.time.format("%F %T").c_str());
 
-        return nullptr;
+        m_wakeup_time = alarm.time;
+        m_timer->set_wakeup_time(alarm.time);
     }
 
 
     std::set<std::pair<std::string,DateTime>> m_triggered;
+    std::map<Key,std::shared_ptr<const Appointment>> m_appointments; // the planner's, by key
+    std::vector<Pending> m_pending; // a min-heap of the alarms yet to kick
+    size_t m_n_alarms = 0; // how many alarms are in m_appointments
+    uint64_t m_seq = 0;
     const std::shared_ptr<Clock> m_clock;
     const std::shared_ptr<Planner> m_planner;
     const std::shared_ptr<WakeupTimer> m_timer;
     core::Signal<const Appointment&, const Alarm&> m_alarm_reached;
     DateTime m_datetime;
+    DateTime m_wakeup_time;
 };
 
 /***
@@ -181,6 +310,24 @@ SimpleAlarmQueue::alarm_reached()
     return impl->alarm_reached();
 }
 
+size_t
+SimpleAlarmQueue::pending_count() const
+{
+    return impl->pending_count();
+}
+
+size_t
+SimpleAlarmQueue::alarm_count() const
+{
+    return impl->alarm_count();
+}
+
+size_t
+SimpleAlarmQueue::triggered_count() const
+{
+    return impl->triggered_count();
+}
+
 /***
 ****
 ***/
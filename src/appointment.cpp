@@ -59,6 +59,64 @@ bool Appointment::operator==(const Appointment& that) const
 *****
 ****/
 
+namespace
+{
+    const std::shared_ptr<const std::vector<Appointment>>& empty_snapshot()
+    {
+        static const auto empty = std::make_shared<const std::vector<Appointment>>();
+        return empty;
+    }
+} // unnamed namespace
+
+AppointmentList::AppointmentList():
+    m_snapshot(empty_snapshot())
+{
+}
+
+AppointmentList::AppointmentList(const std::vector<Appointment>& appointments):
+    m_snapshot(appointments.empty() ? empty_snapshot() : std::make_shared<const std::vector<Appointment>>(appointments))
+{
+}
+
+AppointmentList::AppointmentList(std::vector<Appointment>&& appointments):
+    m_snapshot(appointments.empty() ? empty_snapshot() : std::make_shared<const std::vector<Appointment>>(std::move(appointments)))
+{
+}
+
+bool operator==(const AppointmentList& a, const AppointmentList& b)
+{
+    return (a.snapshot() == b.snapshot()) || (a.get() == b.get());
+}
+
+bool operator==(const AppointmentList& a, const std::vector<Appointment>& b)
+{
+    return a.get() == b;
+}
+
+bool operator==(const std::vector<Appointment>& a, const AppointmentList& b)
+{
+    return a == b.get();
+}
+
+bool operator!=(const AppointmentList& a, const AppointmentList& b)
+{
+    return !(a == b);
+}
+
+bool operator!=(const AppointmentList& a, const std::vector<Appointment>& b)
+{
+    return !(a == b);
+}
+
+bool operator!=(const std::vector<Appointment>& a, const AppointmentList& b)
+{
+    return !(a == b);
+}
+
+/****
+*****
+****/
+
 } // namespace datetime
 } // namespace indicator
 } // namespace unity
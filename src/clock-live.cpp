@@ -18,17 +18,9 @@
  */
 
 #include <datetime/clock.h>
+#include <datetime/timer-service.h>
 #include <datetime/timezone.h>
 
-#include <glib-unix.h> // g_unix_fd_add()
-
-#include <sys/timerfd.h>
-#include <unistd.h> // close()
-
-#ifndef TFD_TIMER_CANCEL_ON_SET
- #define TFD_TIMER_CANCEL_ON_SET (1 << 1)
-#endif
-
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -43,7 +35,8 @@ public:
 
     Impl(LiveClock& owner, const std::shared_ptr<const Timezone>& timezone_):
         m_owner(owner),
-        m_timezone(timezone_)
+        m_timezone(timezone_),
+        m_clock_set_connection(TimerService::get_default().clock_set().connect([this](){on_clock_set();}))
     {
         if (m_timezone)
         {
@@ -67,27 +60,14 @@ public:
     {
         g_assert(m_gtimezone != nullptr);
 
-        auto gdt = g_date_time_new_now(m_gtimezone);
-        DateTime ret(m_gtimezone, gdt);
-        g_date_time_unref(gdt);
-        return ret;
+        return DateTime::Now(m_gtimezone);
     }
 
 private:
 
     void unset_timer()
     {
-        if (m_timerfd_tag != 0)
-        {
-            g_source_remove(m_timerfd_tag);
-            m_timerfd_tag = 0;
-        }
-
-        if (m_timerfd != -1)
-        {
-            close(m_timerfd);
-            m_timerfd = -1;
-        }
+        TimerService::get_default().remove(m_timer_tag);
     }
 
     void reset_timer()
@@ -95,64 +75,35 @@ private:
         // clear out any previous timer
         unset_timer();
 
-        // create a new timer
-        m_timerfd = timerfd_create(CLOCK_REALTIME, 0);
-        if (m_timerfd == -1)
-            g_error("unable to create realtime timer: %s", g_strerror(errno));
-
-        // set args to fire at the beginning of the next minute...
-        struct itimerspec timerval;
-        int flags = TFD_TIMER_ABSTIME;
+        // fire at the beginning of the next minute
         auto now = g_date_time_new_now(m_gtimezone);
         auto next = g_date_time_add_minutes(now, 1);
         auto start_of_next = g_date_time_add_seconds(next, -g_date_time_get_seconds(next));
-        timerval.it_value.tv_sec = g_date_time_to_unix(start_of_next);
-        timerval.it_value.tv_nsec = 0;
+        const auto deadline_usec = g_date_time_to_unix(start_of_next) * G_USEC_PER_SEC;
         g_date_time_unref(start_of_next);
         g_date_time_unref(next);
         g_date_time_unref(now);
-        // ...and also to fire at the beginning of every subsequent minute...
-        timerval.it_interval.tv_sec = 60;
-        timerval.it_interval.tv_nsec = 0;
-        // ...and also to fire if someone changes the time
-        // manually (eg toggling from manual<->ntp)
-        flags |= TFD_TIMER_CANCEL_ON_SET;
-
-        if (timerfd_settime(m_timerfd, flags, &timerval, NULL) == -1)
-            g_error("timerfd_settime failed: %s", g_strerror(errno));
-
-        // listen for the changes/timers
-        m_timerfd_tag = g_unix_fd_add(m_timerfd,
-                                      (GIOCondition)(G_IO_IN|G_IO_HUP|G_IO_ERR),
-                                      on_timerfd_cond,
-                                      this);
+
+        // the minute has to change on time, so don't allow any slack
+        m_timer_tag = TimerService::get_default().add_at(deadline_usec, 0, [this](){
+            m_timer_tag = 0;
+            reset_timer();
+            refresh();
+        });
     }
 
-    static gboolean on_timerfd_cond (gint fd, GIOCondition cond, gpointer gself)
+    void on_clock_set()
     {
-        auto self = static_cast<Impl*>(gself);
-
-        int n_bytes = 0;
-        uint64_t n_interrupts = 0;
-        if (cond & G_IO_IN)
-            n_bytes = read(fd, &n_interrupts, sizeof(uint64_t));
+        auto now = g_date_time_new_now(m_gtimezone);
+        auto now_str = g_date_time_format(now, "%F %T");
+        g_debug("%s triggered at %s.%06d",
+                G_STRFUNC, now_str, g_date_time_get_microsecond(now));
+        g_free(now_str);
+        g_date_time_unref(now);
 
-        if ((n_interrupts==0) || (n_bytes!=sizeof(uint64_t)))
-        {
-            auto now = g_date_time_new_now(self->m_gtimezone);
-            auto now_str = g_date_time_format(now, "%F %T");
-            g_debug("%s triggered at %s.%06d by GIOCondition %d, read %zd bytes, found %zu interrupts",
-                    G_STRFUNC, now_str, g_date_time_get_microsecond(now),
-                    (int)cond, n_bytes, n_interrupts);
-            g_free(now_str);
-            g_date_time_unref(now);
-
-            // reset the timer in case someone changed the system clock
-            self->reset_timer();
-        }
-  
-        self->refresh();
-        return G_SOURCE_CONTINUE;
+        // reset the timer since someone changed the system clock
+        reset_timer();
+        refresh();
     }
 
     /***
@@ -190,8 +141,8 @@ protected:
     std::shared_ptr<const Timezone> m_timezone;
 
     DateTime m_prev_datetime;
-    int m_timerfd = -1;
-    guint m_timerfd_tag = 0;
+    guint m_timer_tag = 0;
+    core::ScopedConnection m_clock_set_connection;
 };
 
 LiveClock::LiveClock(const std::shared_ptr<const Timezone>& timezone_):
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/compiled-format.h>
+
+#include <glib.h>
+
+#include <cstring> // strchr()
+
+#include <locale.h> // setlocale()
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+namespace
+{
+
+// conversions that show the seconds
+bool conversion_shows_seconds(char conversion)
+{
+    return strchr("sSTXcr", conversion) != nullptr;
+}
+
+void append_number(std::string& str, int value, int width, char pad)
+{
+    char digits[16];
+    int n = 0;
+    do {
+        digits[n++] = char('0' + (value % 10));
+        value /= 10;
+    } while (value && (n < int(sizeof(digits))));
+
+    for (int i=n; i<width; ++i)
+        str += pad;
+    while (n)
+        str += digits[--n];
+}
+
+int to_12h(int hour)
+{
+    hour %= 12;
+    return hour ? hour : 12;
+}
+
+} // unnamed namespace
+
+/***
+****
+***/
+
+CompiledFormat::CompiledFormat(const std::string& fmt):
+    m_source(fmt)
+{
+    auto add_literal = [this](const std::string& str){
+        if (m_ops.empty() || (m_ops.back().conversion != 0))
+            m_ops.push_back(Op{0, std::string(), 0, true, std::string(), 0});
+        m_ops.back().text += str;
+    };
+
+    for (size_t i=0, n=fmt.size(); i<n; ++i)
+    {
+        if ((fmt[i] != '%') || (i+1 == n))
+        {
+            add_literal(std::string(1, fmt[i]));
+            continue;
+        }
+
+        // grab the whole spec, including any padding or E/O modifiers
+        const auto begin = i++;
+        while ((i+1 < n) && strchr("-_0^#EO", fmt[i]))
+            ++i;
+        const auto spec = fmt.substr(begin, i+1-begin);
+        const auto conversion = fmt[i];
+
+        if (spec == "%%")
+            add_literal("%");
+        else if (spec == "%n")
+            add_literal("\n");
+        else if (spec == "%t")
+            add_literal("\t");
+        else {
+            // modified specs are left to glib
+            const char c = spec.size() == 2 ? conversion : '?';
+            m_ops.push_back(Op{c, spec, 0, false, std::string(), 0});
+        }
+
+        m_shows_seconds |= conversion_shows_seconds(conversion);
+    }
+}
+
+// the value that a field's text depends on,
+// so that we can tell when it needs to be rerendered
+int64_t
+CompiledFormat::key_of(const Op& op, GDateTime* dt)
+{
+    switch (op.conversion)
+    {
+        case 'S': return g_date_time_get_second(dt);
+        case 'M': return g_date_time_get_minute(dt);
+        case 'H': case 'k': case 'I': case 'l': return g_date_time_get_hour(dt);
+        case 'p': case 'P': return g_date_time_get_hour(dt) < 12;
+        case 'd': case 'e': return g_date_time_get_day_of_month(dt);
+        case 'a': case 'A': case 'u': case 'w': return g_date_time_get_day_of_week(dt);
+        case 'm': case 'b': case 'B': case 'h': return g_date_time_get_month(dt);
+        case 'y': case 'Y': return g_date_time_get_year(dt);
+        case 'j': return g_date_time_get_day_of_year(dt);
+        case 'z': case 'Z': return g_date_time_get_utc_offset(dt);
+        default: break;
+    }
+
+    // everything else depends on the whole local time
+    return g_date_time_to_unix(dt) + g_date_time_get_utc_offset(dt)/G_USEC_PER_SEC;
+}
+
+void
+CompiledFormat::render(Op& op, GDateTime* dt)
+{
+    op.text.clear();
+
+    switch (op.conversion)
+    {
+        case 'S': append_number(op.text, g_date_time_get_second(dt), 2, '0'); return;
+        case 'M': append_number(op.text, g_date_time_get_minute(dt), 2, '0'); return;
+        case 'H': append_number(op.text, g_date_time_get_hour(dt), 2, '0'); return;
+        case 'I': append_number(op.text, to_12h(g_date_time_get_hour(dt)), 2, '0'); return;
+        case 'd': append_number(op.text, g_date_time_get_day_of_month(dt), 2, '0'); return;
+        case 'm': append_number(op.text, g_date_time_get_month(dt), 2, '0'); return;
+        case 'y': append_number(op.text, g_date_time_get_year(dt) % 100, 2, '0'); return;
+        case 'Y': append_number(op.text, g_date_time_get_year(dt), 1, '0'); return;
+        case 'j': append_number(op.text, g_date_time_get_day_of_year(dt), 3, '0'); return;
+        default: break;
+    }
+
+    // names and composites depend on the locale, and glib pads %e, %k, and %l
+    // with figure spaces, so let glib do those
+    auto str = g_date_time_format(dt, op.spec.c_str());
+    if (str != nullptr)
+        op.text = str;
+    g_free(str);
+}
+
+const std::string&
+CompiledFormat::format(const DateTime& dt)
+{
+    auto gdt = dt.get();
+    bool relayout = m_buffer.empty();
+
+    // day names, am/pm, and zone abbreviations aren't covered by the keys
+    const char* locale = setlocale(LC_TIME, nullptr);
+    if ((dt.timezone() != m_timezone) || (m_locale != (locale ? locale : "")))
+    {
+        m_timezone = dt.timezone();
+        m_locale = locale ? locale : "";
+        for (auto& op : m_ops)
+            if (op.conversion != 0)
+                op.rendered = false;
+    }
+
+    for (auto& op : m_ops)
+    {
+        if (op.conversion == 0)
+            continue;
+
+        const auto key = key_of(op, gdt);
+        if (op.rendered && (key == op.key))
+            continue;
+
+        const auto old_size = op.text.size();
+        render(op, gdt);
+        op.key = key;
+        op.rendered = true;
+
+        // if it's the same width, overwrite it in place
+        if (!relayout && (op.text.size() == old_size))
+            m_buffer.replace(op.offset, old_size, op.text);
+        else
+            relayout = true;
+    }
+
+    if (relayout)
+    {
+        m_buffer.clear();
+        for (auto& op : m_ops)
+        {
+            op.offset = m_buffer.size();
+            m_buffer += op.text;
+        }
+    }
+
+    return m_buffer;
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
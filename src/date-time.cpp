@@ -19,6 +19,9 @@
 
 #include <datetime/date-time.h>
 
+#include <mutex>
+#include <set>
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -27,10 +30,36 @@ namespace datetime {
 ****
 ***/
 
+namespace
+{
+    // floor division, so that instants before the epoch round down
+    int64_t floor_div(int64_t a, int64_t b)
+    {
+        return (a / b) - ((a % b) < 0 ? 1 : 0);
+    }
+
+    GTimeSpan instant_of(GDateTime* gdt)
+    {
+        return g_date_time_to_unix(gdt) * G_TIME_SPAN_SECOND + g_date_time_get_microsecond(gdt);
+    }
+} // unnamed namespace
+
+/***
+****
+***/
+
 DateTime::DateTime()
 {
 }
 
+DateTime DateTime::from_instant(GTimeZone* interned_tz, GTimeSpan usec)
+{
+    DateTime dt;
+    dt.m_tz = interned_tz;
+    dt.m_usec = usec;
+    return dt;
+}
+
 DateTime::DateTime(GTimeZone* gtz, GDateTime* gdt)
 {
     g_return_if_fail(gtz!=nullptr);
@@ -48,10 +77,44 @@ DateTime::DateTime(GTimeZone* gtz, int year, int month, int day, int hour, int m
     g_date_time_unref(gdt);
 }
 
+DateTime::DateTime(const DateTime& that):
+    m_usec(that.m_usec),
+    m_tz(that.m_tz),
+    m_dt(ref_or_null(that.m_dt.load()))
+{
+}
+
+DateTime::DateTime(DateTime&& that):
+    m_usec(that.m_usec),
+    m_tz(that.m_tz),
+    m_dt(that.m_dt.exchange(nullptr))
+{
+}
+
+DateTime::~DateTime()
+{
+    replace_dt(nullptr);
+}
+
 DateTime& DateTime::operator=(const DateTime& that)
 {
-    m_tz = that.m_tz;
-    m_dt = that.m_dt;
+    if (this != &that)
+    {
+        m_usec = that.m_usec;
+        m_tz = that.m_tz;
+        replace_dt(ref_or_null(that.m_dt.load()));
+    }
+    return *this;
+}
+
+DateTime& DateTime::operator=(DateTime&& that)
+{
+    if (this != &that)
+    {
+        m_usec = that.m_usec;
+        m_tz = that.m_tz;
+        replace_dt(that.m_dt.exchange(nullptr));
+    }
     return *this;
 }
 
@@ -65,32 +128,30 @@ DateTime& DateTime::operator+=(const std::chrono::seconds& seconds)
     return (*this = add_full(0, 0, 0, 0, 0, seconds.count()));
 }
 
-DateTime::DateTime(GTimeZone* gtz, time_t t)
+DateTime::DateTime(GTimeZone* gtz, time_t t):
+    m_usec(GTimeSpan(t) * G_TIME_SPAN_SECOND),
+    m_tz(gtz ? intern(gtz) : nullptr)
 {
-    auto utc = g_date_time_new_from_unix_utc(t);
-    auto gdt = g_date_time_to_timezone (utc, gtz);
-    reset(gtz, gdt);
-    g_date_time_unref(gdt);
-    g_date_time_unref(utc);
 }
 
 DateTime DateTime::NowLocal()
 {
     auto gtz = g_time_zone_new_local();
-    auto gdt = g_date_time_new_now(gtz);
-    DateTime dt(gtz, gdt);
+    auto dt = from_instant(intern(gtz), g_get_real_time());
     g_time_zone_unref(gtz);
-    g_date_time_unref(gdt);
     return dt;
 }
 
+DateTime DateTime::Now(GTimeZone* gtz)
+{
+    return from_instant(intern(gtz), g_get_real_time());
+}
+
 DateTime DateTime::Local(time_t t)
 {
     auto gtz = g_time_zone_new_local();
-    auto gdt = g_date_time_new_from_unix_local(t);
-    DateTime dt(gtz, gdt);
+    DateTime dt(gtz, t);
     g_time_zone_unref(gtz);
-    g_date_time_unref(gdt);
     return dt;
 }
 
@@ -105,10 +166,8 @@ DateTime DateTime::Local(int year, int month, int day, int hour, int minute, dou
 DateTime DateTime::to_timezone(const std::string& zone) const
 {
     auto gtz = g_time_zone_new(zone.c_str());
-    auto gdt = g_date_time_to_timezone(get(), gtz);
-    DateTime dt(gtz, gdt);
+    auto dt = from_instant(intern(gtz), m_usec);
     g_time_zone_unref(gtz);
-    g_date_time_unref(gdt);
     return dt;
 }
 
@@ -132,7 +191,7 @@ DateTime DateTime::start_of_month() const
 
     int year=0, month=0, day=0;
     ymd(year, month, day);
-    return DateTime(m_tz.get(), year, month, 1, 0, 0, 0);
+    return DateTime(m_tz, year, month, 1, 0, 0, 0);
 }
 
 DateTime DateTime::start_of_day() const
@@ -141,7 +200,7 @@ DateTime DateTime::start_of_day() const
 
     int year=0, month=0, day=0;
     ymd(year, month, day);
-    return DateTime(m_tz.get(), year, month, day, 0, 0, 0);
+    return DateTime(m_tz, year, month, day, 0, 0, 0);
 }
 
 DateTime DateTime::start_of_minute() const
@@ -150,13 +209,24 @@ DateTime DateTime::start_of_minute() const
 
     int year=0, month=0, day=0;
     ymd(year, month, day);
-    return DateTime(m_tz.get(), year, month, day, hour(), minute(), 0);
+    return DateTime(m_tz, year, month, day, hour(), minute(), 0);
 }
 
 DateTime DateTime::add_full(int year, int month, int day, int hour, int minute, double seconds) const
 {
+    // like g_date_time_add_full(), hours/minutes/seconds are absolute time,
+    // so they don't need the calendar
+    if (!year && !month && !day)
+    {
+        g_assert(is_set());
+        const GTimeSpan span = hour * G_TIME_SPAN_HOUR
+                             + minute * G_TIME_SPAN_MINUTE
+                             + GTimeSpan(seconds * G_TIME_SPAN_SECOND);
+        return from_instant(m_tz, m_usec + span);
+    }
+
     auto gdt = g_date_time_add_full(get(), year, month, day, hour, minute, seconds);
-    DateTime dt(m_tz.get(), gdt);
+    DateTime dt(m_tz, gdt);
     g_date_time_unref(gdt);
     return dt;
 }
@@ -168,8 +238,27 @@ DateTime DateTime::add_days(int days) const
 
 GDateTime* DateTime::get() const
 {
-    g_assert(m_dt);
-    return m_dt.get();
+    g_assert(is_set());
+
+    auto dt = m_dt.load();
+    if (dt == nullptr)
+    {
+        auto utc = g_date_time_new_from_unix_utc(floor_div(m_usec, G_TIME_SPAN_SECOND));
+        auto tmp = g_date_time_add(utc, m_usec - floor_div(m_usec, G_TIME_SPAN_SECOND) * G_TIME_SPAN_SECOND);
+        dt = g_date_time_to_timezone(tmp, m_tz);
+        g_date_time_unref(tmp);
+        g_date_time_unref(utc);
+
+        // const calls may race to build it; the first one in wins
+        GDateTime* expected = nullptr;
+        if (!m_dt.compare_exchange_strong(expected, dt))
+        {
+            g_date_time_unref(dt);
+            dt = expected;
+        }
+    }
+
+    return dt;
 }
 
 std::string DateTime::format(const std::string& fmt) const
@@ -213,7 +302,43 @@ double DateTime::seconds() const
 
 int64_t DateTime::to_unix() const
 {
-    return g_date_time_to_unix(get());
+    g_assert(is_set());
+    return floor_div(m_usec, G_TIME_SPAN_SECOND);
+}
+
+int DateTime::interval() const
+{
+    g_assert(is_set());
+    return g_time_zone_find_interval(m_tz, G_TIME_TYPE_UNIVERSAL, to_unix());
+}
+
+GTimeSpan DateTime::utc_offset() const
+{
+    return GTimeSpan(g_time_zone_get_offset(m_tz, interval())) * G_TIME_SPAN_SECOND;
+}
+
+int64_t DateTime::day_number() const
+{
+    return floor_div(m_usec + utc_offset(), G_TIME_SPAN_DAY);
+}
+
+const char* DateTime::timezone_abbreviation() const
+{
+    return g_time_zone_get_abbreviation(m_tz, interval());
+}
+
+// Returns a timezone that lives as long as the process does.
+// There are only ever a handful of them, so the table stays small.
+GTimeZone* DateTime::intern(GTimeZone* gtz)
+{
+    static std::mutex mutex;
+    static std::set<GTimeZone*> zones;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = zones.find(gtz);
+    if (it == zones.end())
+        it = zones.insert(g_time_zone_ref(gtz)).first;
+    return *it;
 }
 
 void DateTime::reset(GTimeZone* gtz, GDateTime* gdt)
@@ -221,57 +346,65 @@ void DateTime::reset(GTimeZone* gtz, GDateTime* gdt)
     g_return_if_fail (gdt!=nullptr);
     g_return_if_fail (gtz!=nullptr);
 
-    auto tz_deleter = [](GTimeZone* tz){g_time_zone_unref(tz);};
-    m_tz = std::shared_ptr<GTimeZone>(g_time_zone_ref(gtz), tz_deleter);
+    m_tz = intern(gtz);
+    m_usec = instant_of(gdt);
+    replace_dt(g_date_time_ref(gdt));
+}
 
-    auto dt_deleter = [](GDateTime* dt){g_date_time_unref(dt);};
-    m_dt = std::shared_ptr<GDateTime>(g_date_time_ref(gdt), dt_deleter);
+GDateTime* DateTime::ref_or_null(GDateTime* gdt)
+{
+    return gdt ? g_date_time_ref(gdt) : nullptr;
+}
+
+void DateTime::replace_dt(GDateTime* gdt)
+{
+    auto old = m_dt.exchange(gdt);
+    if (old != nullptr)
+        g_date_time_unref(old);
 }
 
 bool DateTime::operator<(const DateTime& that) const
 {
-    return g_date_time_compare(get(), that.get()) < 0;
+    return m_usec < that.m_usec;
 }
 
 bool DateTime::operator>(const DateTime& that) const
 {
-    return g_date_time_compare(get(), that.get()) > 0;
+    return m_usec > that.m_usec;
 }
 
 bool DateTime::operator<=(const DateTime& that) const
 {
-    return g_date_time_compare(get(), that.get()) <= 0;
+    return m_usec <= that.m_usec;
 }
 
 bool DateTime::operator>=(const DateTime& that) const
 {
-    return g_date_time_compare(get(), that.get()) >= 0;
+    return m_usec >= that.m_usec;
 }
 
 bool DateTime::operator!=(const DateTime& that) const
 {
     // return true if this isn't set, or if it's not equal
-    return (!m_dt) || !(*this == that);
+    return !is_set() || !(*this == that);
 }
 
 bool DateTime::operator==(const DateTime& that) const
 {
-    auto dt = get();
-    auto tdt = that.get();
-    if (!dt && !tdt) return true;
-    if (!dt || !tdt) return false;
-    return g_date_time_compare(get(), that.get()) == 0;
+    if (!is_set() && !that.is_set()) return true;
+    if (!is_set() || !that.is_set()) return false;
+    return m_usec == that.m_usec;
 }
 
 int64_t DateTime::operator- (const DateTime& that) const
 {
-    return g_date_time_difference(get(), that.get());
+    return m_usec - that.m_usec;
 }
 
 bool DateTime::is_same_day(const DateTime& a, const DateTime& b)
 {
     // it's meaningless to compare uninitialized dates
-    if (!a.m_dt || !b.m_dt)
+    if (!a.is_set() || !b.is_set())
         return false;
 
     int ay, am, ad;
@@ -0,0 +1,524 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/engine-cache.h>
+
+#include <algorithm> // std::sort()
+#include <list>
+#include <map>
+#include <set>
+#include <tuple>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/****
+*****
+****/
+
+class CacheEngine::Impl
+{
+    typedef std::function<void(const std::vector<Appointment>&, bool)> appointment_batch_func;
+    typedef std::pair<DateTime,DateTime> Interval;
+
+public:
+
+    Impl(const std::shared_ptr<Engine>& engine):
+        m_engine(engine),
+        m_engine_changed(m_engine->changed().connect([this](){
+            g_debug("CacheEngine %p flushing because the engine changed", this);
+            clear();
+            m_changed();
+        }))
+    {
+    }
+
+    ~Impl()
+    {
+        // abandon the fetches that are still underway
+        for (auto& fetch : m_fetches)
+        {
+            for (auto& request : fetch->waiters)
+                request->disconnect();
+            g_cancellable_cancel(fetch->cancellable.get());
+        }
+    }
+
+    core::Signal<>& changed()
+    {
+        return m_changed;
+    }
+
+    void stream_appointments(const DateTime& begin,
+                             const DateTime& end,
+                             const Timezone& timezone,
+                             appointment_batch_func func,
+                             GCancellable* cancellable)
+    {
+        if (g_cancellable_is_cancelled(cancellable))
+            return;
+
+        const auto& zone = timezone.timezone.get();
+        if (zone != m_timezone)
+        {
+            clear();
+            m_timezone = zone;
+        }
+
+        const Interval want {begin, end};
+        auto request = std::make_shared<Request>(this, want, func, cancellable);
+
+        // start with what we already have...
+        for (const auto& appointment : m_appointments)
+            if (overlaps(appointment, want))
+                request->appointments.push_back(appointment);
+
+        // ...wait for the fetches that are already underway...
+        std::vector<Interval> have = m_covered;
+        for (auto& fetch : m_fetches)
+        {
+            if (fetch->generation != m_generation) // stale
+                continue;
+            if (overlaps(fetch->range, want))
+            {
+                ++request->pending;
+                fetch->waiters.push_back(request);
+                request->fetches.push_back(fetch);
+            }
+            have.push_back(fetch->range);
+        }
+
+        // ...and fetch whatever is still missing.
+        for (const auto& gap : subtract(want, have))
+        {
+            g_debug("CacheEngine %p fetching gap [%s..%s]", this,
+                    gap.first.format("%F %T").c_str(),
+                    gap.second.format("%F %T").c_str());
+
+            auto fetch = std::make_shared<Fetch>(gap, m_generation);
+            fetch->waiters.push_back(request);
+            request->fetches.push_back(fetch);
+            ++request->pending;
+            m_fetches.push_back(fetch);
+
+            m_engine->stream_appointments(gap.first, gap.second, timezone, [this, fetch](const std::vector<Appointment>& appointments, bool done){
+                if (done)
+                    on_fetched(fetch, appointments);
+                else
+                    on_partial(fetch, appointments);
+            }, fetch->cancellable.get());
+        }
+
+        // if we have to wait, let the caller have what we've got so far
+        if ((request->pending > 1) && !request->appointments.empty())
+            request->func(request->appointments, false);
+
+        finish(request);
+    }
+
+    void disable_ubuntu_alarm(const Appointment& appointment)
+    {
+        m_engine->disable_ubuntu_alarm(appointment);
+    }
+
+    void watch_range(const void* key, const DateTime& begin, const DateTime& end)
+    {
+        m_watched[key] = Interval{begin, end};
+        m_engine->watch_range(key, begin, end);
+        forget_unwatched();
+    }
+
+    void unwatch_range(const void* key)
+    {
+        m_watched.erase(key);
+        m_engine->unwatch_range(key);
+        forget_unwatched();
+    }
+
+private:
+
+    struct Fetch;
+
+    struct Request
+    {
+        Request(Impl* owner_in, const Interval& range_in, appointment_batch_func func_in, GCancellable* cancellable_in):
+            owner(owner_in), range(range_in), func(func_in)
+        {
+            if (cancellable_in != nullptr)
+            {
+                cancellable = G_CANCELLABLE(g_object_ref(cancellable_in));
+                cancelled_tag = g_signal_connect(cancellable, "cancelled", G_CALLBACK(on_cancelled), this);
+            }
+        }
+
+        ~Request()
+        {
+            disconnect();
+            g_clear_object(&cancellable);
+        }
+
+        void disconnect()
+        {
+            if (cancelled_tag)
+            {
+                g_signal_handler_disconnect(cancellable, cancelled_tag);
+                cancelled_tag = 0;
+            }
+        }
+
+        bool is_cancelled() const
+        {
+            return g_cancellable_is_cancelled(cancellable);
+        }
+
+        static void on_cancelled(GCancellable* /*cancellable*/, gpointer grequest)
+        {
+            auto request = static_cast<Request*>(grequest);
+            request->owner->cancel(request);
+        }
+
+        Impl* owner;
+        const Interval range;
+        appointment_batch_func func;
+        GCancellable* cancellable {};
+        gulong cancelled_tag {};
+        std::vector<Appointment> appointments;
+        std::vector<std::shared_ptr<Fetch>> fetches;
+        int pending = 1; // released at the end of get_appointments()
+    };
+
+    struct Fetch
+    {
+        Fetch(const Interval& range_in, unsigned int generation_in):
+            range(range_in),
+            generation(generation_in),
+            cancellable(g_cancellable_new(), [](GCancellable* c){g_object_unref(c);}) {}
+
+        const Interval range;
+        const unsigned int generation;
+        std::shared_ptr<GCancellable> cancellable;
+        std::vector<std::shared_ptr<Request>> waiters;
+    };
+
+    // stop waiting for the request's fetches, and abandon the ones nobody else wants
+    void cancel(Request* request)
+    {
+        g_debug("CacheEngine %p request was cancelled", this);
+
+        auto fetches = std::move(request->fetches);
+        request->fetches.clear();
+        request->disconnect();
+
+        for (auto& fetch : fetches)
+        {
+            auto& w = fetch->waiters;
+            w.erase(std::remove_if(w.begin(), w.end(), [request](const std::shared_ptr<Request>& r){return r.get() == request;}), w.end());
+
+            if (w.empty())
+            {
+                g_debug("CacheEngine %p abandoning fetch nobody is waiting for", this);
+                m_fetches.remove(fetch);
+                g_cancellable_cancel(fetch->cancellable.get());
+            }
+        }
+    }
+
+    static bool overlaps(const Interval& a, const Interval& b)
+    {
+        return !(a.second < b.first) && !(b.second < a.first);
+    }
+
+    static bool overlaps(const Appointment& appointment, const Interval& range)
+    {
+        return overlaps(Interval{appointment.begin, appointment.end}, range);
+    }
+
+    // returns the parts of 'want' that aren't in 'have'
+    static std::vector<Interval> subtract(const Interval& want, std::vector<Interval> have)
+    {
+        std::sort(have.begin(), have.end(), [](const Interval& a, const Interval& b){return a.first < b.first;});
+
+        std::vector<Interval> gaps;
+
+        if (!(want.first < want.second)) // an instant
+        {
+            auto covers = [&want](const Interval& i){return (i.first <= want.first) && (want.second <= i.second);};
+            if (std::none_of(have.begin(), have.end(), covers))
+                gaps.push_back(want);
+            return gaps;
+        }
+
+        auto cursor = want.first;
+        for (const auto& interval : have)
+        {
+            if (interval.second < cursor)
+                continue;
+            if (want.second < interval.first)
+                break;
+            if (cursor < interval.first)
+                gaps.push_back(Interval{cursor, interval.first});
+            if (cursor < interval.second)
+                cursor = interval.second;
+        }
+        if (cursor < want.second)
+            gaps.push_back(Interval{cursor, want.second});
+
+        return gaps;
+    }
+
+    // returns the intervals sorted, with overlapping ones combined
+    static std::vector<Interval> merge(std::vector<Interval> intervals)
+    {
+        std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b){return a.first < b.first;});
+
+        std::vector<Interval> merged;
+        for (const auto& interval : intervals)
+        {
+            if (!merged.empty() && !(merged.back().second < interval.first))
+            {
+                if (merged.back().second < interval.second)
+                    merged.back().second = interval.second;
+            }
+            else
+            {
+                merged.push_back(interval);
+            }
+        }
+        return merged;
+    }
+
+    void clear()
+    {
+        ++m_generation; // in-flight fetches are now stale
+        m_covered.clear();
+        m_appointments.clear();
+        m_keys.clear();
+    }
+
+    void cover(const Interval& range)
+    {
+        // if the cache is getting fragmented, e.g. from paging through
+        // the calendar, start over instead of holding onto everything
+        static constexpr size_t MAX_INTERVALS = 4;
+
+        m_covered.push_back(range);
+        auto merged = merge(m_covered);
+
+        if (merged.size() > MAX_INTERVALS)
+        {
+            m_appointments.clear();
+            m_keys.clear();
+            merged.assign(1, range);
+        }
+
+        m_covered.swap(merged);
+    }
+
+    // The wrapped engine may not report changes outside of the watched
+    // ranges, so stop trusting whatever we've cached outside of them
+    void forget_unwatched()
+    {
+        if (m_watched.empty())
+            return;
+
+        std::vector<Interval> watched;
+        for (const auto& kv : m_watched)
+            watched.push_back(kv.second);
+
+        std::vector<Interval> covered;
+        for (const auto& c : m_covered)
+        {
+            for (const auto& w : watched)
+            {
+                if (!overlaps(c, w))
+                    continue;
+                const auto& begin = std::max(c.first, w.first);
+                const auto& end = std::min(c.second, w.second);
+                if (begin < end)
+                    covered.push_back(Interval{begin, end});
+            }
+        }
+
+        covered = merge(covered);
+        if (covered == m_covered)
+            return;
+
+        g_debug("CacheEngine %p forgetting unwatched appointments", this);
+        m_covered.swap(covered);
+
+        auto& a = m_appointments;
+        a.erase(std::remove_if(a.begin(), a.end(), [this](const Appointment& appt){
+            return std::none_of(m_covered.begin(), m_covered.end(), [&appt](const Interval& i){return overlaps(appt, i);});
+        }), a.end());
+        m_keys.clear();
+        for (const auto& appointment : a)
+            m_keys.insert(key(appointment));
+    }
+
+    void add(const std::vector<Appointment>& appointments)
+    {
+        for (const auto& appointment : appointments)
+            if (m_keys.insert(key(appointment)).second)
+                m_appointments.push_back(appointment);
+    }
+
+    typedef std::tuple<std::string,int64_t,int64_t> Key;
+
+    static Key key(const Appointment& appointment)
+    {
+        return Key{appointment.uid, appointment.begin.to_unix(), appointment.end.to_unix()};
+    }
+
+    // pass a source's results along to the waiters; on_fetched() will have them all
+    void on_partial(const std::shared_ptr<Fetch>& fetch, const std::vector<Appointment>& appointments)
+    {
+        if (g_cancellable_is_cancelled(fetch->cancellable.get()))
+            return;
+
+        auto waiters = fetch->waiters; // a callback might cancel its request
+        for (auto& request : waiters)
+        {
+            if (request->is_cancelled())
+                continue;
+
+            std::vector<Appointment> batch;
+            for (const auto& appointment : appointments)
+                if (overlaps(appointment, request->range))
+                    batch.push_back(appointment);
+            if (!batch.empty())
+                request->func(batch, false);
+        }
+    }
+
+    void on_fetched(const std::shared_ptr<Fetch>& fetch, const std::vector<Appointment>& appointments)
+    {
+        if (g_cancellable_is_cancelled(fetch->cancellable.get()))
+            return;
+
+        m_fetches.remove(fetch);
+
+        if (fetch->generation == m_generation)
+        {
+            cover(fetch->range);
+            add(appointments);
+        }
+
+        for (auto& request : fetch->waiters)
+        {
+            auto& f = request->fetches;
+            f.erase(std::remove(f.begin(), f.end(), fetch), f.end());
+
+            for (const auto& appointment : appointments)
+                if (overlaps(appointment, request->range))
+                    request->appointments.push_back(appointment);
+            finish(request);
+        }
+    }
+
+    void finish(const std::shared_ptr<Request>& request)
+    {
+        if (--request->pending > 0)
+            return;
+
+        request->disconnect();
+        if (request->is_cancelled())
+            return;
+
+        // gaps share their endpoints, so weed out duplicates
+        auto& a = request->appointments;
+        std::set<Key> keys;
+        a.erase(std::remove_if(a.begin(), a.end(), [&keys](const Appointment& appt){return !keys.insert(key(appt)).second;}), a.end());
+        std::sort(a.begin(), a.end(), [](const Appointment& x, const Appointment& y){return x.begin < y.begin;});
+
+        g_debug("CacheEngine %p answering request with %zu appointments", this, a.size());
+        request->func(a, true);
+    }
+
+    const std::shared_ptr<Engine> m_engine;
+    core::ScopedConnection m_engine_changed;
+    core::Signal<> m_changed;
+    std::string m_timezone;
+    unsigned int m_generation {};
+    std::vector<Interval> m_covered; // sorted, disjoint
+    std::vector<Appointment> m_appointments;
+    std::set<Key> m_keys;
+    std::list<std::shared_ptr<Fetch>> m_fetches;
+    std::map<const void*,Interval> m_watched;
+};
+
+/***
+****
+***/
+
+CacheEngine::CacheEngine(const std::shared_ptr<Engine>& engine):
+    p(new Impl(engine))
+{
+}
+
+CacheEngine::~CacheEngine() =default;
+
+core::Signal<>& CacheEngine::changed()
+{
+    return p->changed();
+}
+
+void CacheEngine::get_appointments(const DateTime& begin,
+                                   const DateTime& end,
+                                   const Timezone& tz,
+                                   std::function<void(const std::vector<Appointment>&)> func,
+                                   GCancellable* cancellable)
+{
+    p->stream_appointments(begin, end, tz, [func](const std::vector<Appointment>& appointments, bool done){
+        if (done)
+            func(appointments);
+    }, cancellable);
+}
+
+void CacheEngine::stream_appointments(const DateTime& begin,
+                                      const DateTime& end,
+                                      const Timezone& tz,
+                                      std::function<void(const std::vector<Appointment>&, bool done)> func,
+                                      GCancellable* cancellable)
+{
+    p->stream_appointments(begin, end, tz, func, cancellable);
+}
+
+void CacheEngine::disable_ubuntu_alarm(const Appointment& appointment)
+{
+    p->disable_ubuntu_alarm(appointment);
+}
+
+void CacheEngine::watch_range(const void* key, const DateTime& begin, const DateTime& end)
+{
+    p->watch_range(key, begin, end);
+}
+
+void CacheEngine::unwatch_range(const void* key)
+{
+    p->unwatch_range(key);
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
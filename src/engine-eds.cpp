@@ -19,6 +19,7 @@
 
 #include <datetime/engine-eds.h>
 #include <datetime/myself.h>
+#include <datetime/timer-service.h>
 
 #include <libical/ical.h>
 #include <libical/icaltime.h>
@@ -31,6 +32,7 @@
 #include <cstring> // strstr(), strlen()
 #include <map>
 #include <set>
+#include <unordered_map>
 
 namespace unity {
 namespace indicator {
@@ -47,6 +49,8 @@ static constexpr char const * X_PROP_ACTIVATION_URL {"X-CANONICAL-ACTIVATION-URL
 
 class EdsEngine::Impl
 {
+    typedef std::function<void(const std::vector<Appointment>&, bool)> appointment_batch_func;
+
 public:
 
     Impl(const std::shared_ptr<Myself> &myself)
@@ -59,7 +63,9 @@ public:
 
         m_cancellable = std::shared_ptr<GCancellable>(g_cancellable_new(), cancellable_deleter);
         e_source_registry_new(m_cancellable.get(), on_source_registry_ready, this);
+        m_startup_tag = g_timeout_add_seconds(MAX_STARTUP_SEC, on_startup_timeout, this);
         m_myself->emails().changed().connect([this](const std::set<std::string> &) {
+            invalidate_all_indices(); // is_component_interesting() depends on these
             set_dirty_soon();
         });
     }
@@ -71,8 +77,12 @@ public:
         while(!m_sources.empty())
             remove_source(*m_sources.begin());
 
-        if (m_rebuild_tag)
-            g_source_remove(m_rebuild_tag);
+        TimerService::get_default().remove(m_rebuild_tag);
+
+        if (m_startup_tag)
+            g_source_remove(m_startup_tag);
+
+        TimerService::get_default().remove(m_window_tag);
 
         if (m_source_registry)
             g_signal_handlers_disconnect_by_data(m_source_registry, this);
@@ -84,11 +94,40 @@ public:
         return m_changed;
     }
 
-    void get_appointments(const DateTime& begin,
-                          const DateTime& end,
-                          const Timezone& timezone,
-                          std::function<void(const std::vector<Appointment>&)> func)
+    void stream_appointments(const DateTime& begin,
+                             const DateTime& end,
+                             const Timezone& timezone,
+                             appointment_batch_func func,
+                             GCancellable* cancellable)
+    {
+        if (g_cancellable_is_cancelled(cancellable))
+            return;
+
+        // until the clients have connected, any answer would be an empty one
+        if (!is_ready())
+        {
+            g_debug("deferring get_appointments until EDS is ready");
+            auto keep = std::shared_ptr<GCancellable>(cancellable ? G_CANCELLABLE(g_object_ref(cancellable)) : nullptr,
+                                                      [](GCancellable* c){g_clear_object(&c);});
+            const auto tz = timezone.timezone.get();
+            m_deferred.push_back([this, begin, end, tz, func, keep](){
+                fetch_appointments(begin, end, tz, func, keep.get());
+            });
+            return;
+        }
+
+        fetch_appointments(begin, end, timezone.timezone.get(), func, cancellable);
+    }
+
+    void fetch_appointments(const DateTime& begin,
+                            const DateTime& end,
+                            const std::string& timezone_name,
+                            appointment_batch_func func,
+                            GCancellable* cancellable)
     {
+        if (g_cancellable_is_cancelled(cancellable))
+            return;
+
         const auto b_str = begin.format("%F %T");
         const auto e_str = end.format("%F %T");
         g_debug("getting all appointments from [%s ... %s]", b_str.c_str(), e_str.c_str());
@@ -97,11 +136,9 @@ public:
         ***  init the default timezone
         **/
         icaltimezone * default_timezone = nullptr;
-        const auto tz = timezone.timezone.get().c_str();
-        auto gtz = timezone_from_name(tz, nullptr, nullptr, &default_timezone);
-        if (gtz == nullptr) {
-            gtz = g_time_zone_new_local();
-        }
+        const auto tz = timezone_name.c_str();
+        auto gtz = lookup_timezone(tz, nullptr, &default_timezone);
+        gtz = gtz ? g_time_zone_ref(gtz) : g_time_zone_new_local();
 
         g_debug("default_timezone is %s", default_timezone ? icaltimezone_get_display_name(default_timezone) : "null");
 
@@ -109,14 +146,21 @@ public:
         ***  walk through the sources to build the appointment list
         **/
 
-        auto main_task = std::make_shared<Task>(this, func, default_timezone, gtz, begin, end);
+        // the task is abandoned if either the caller or the engine gives up on it
+        auto main_task = std::make_shared<Task>(this,
+                                                func,
+                                                create_cancellable({m_cancellable.get(), cancellable}),
+                                                default_timezone,
+                                                gtz,
+                                                begin,
+                                                end);
 
+        bool waiting = false;
         for (auto& kv : m_clients)
         {
             auto& client = kv.second;
             if (default_timezone != nullptr)
                 e_cal_client_set_default_timezone(client, default_timezone);
-            g_debug("calling e_cal_client_generate_instances for %p", (void*)client);
 
             auto& source = kv.first;
             auto extension = e_source_get_extension(source, E_SOURCE_EXTENSION_CALENDAR);
@@ -125,23 +169,59 @@ public:
                 g_debug("Soure is not selected, ignore it: %s", e_source_get_display_name(source));
                 continue;
             }
+
+            // if we've already indexed this range, there's no need to ask EDS
+            auto iit = m_indices.find(source);
+            if ((iit != m_indices.end()) && iit->second.covers(begin, end, timezone_name))
+            {
+                g_debug("using indexed appointments for %s", e_source_get_display_name(source));
+                iit->second.get_appointments(begin, end, main_task->appointments);
+                continue;
+            }
+
+            g_debug("calling e_cal_client_generate_instances for %p", (void*)client);
             const auto color = e_source_selectable_get_color(E_SOURCE_SELECTABLE(extension));
+            auto subtask = new ClientSubtask(main_task, client, color);
+            waiting = true;
+            const auto serial = m_index_serials[source];
+            subtask->index_func = [this, source, serial, begin, end, timezone_name](const std::vector<Appointment>& appointments){
+                add_to_index(source, serial, begin, end, timezone_name, appointments);
+            };
 
             e_cal_client_generate_instances(
                 client,
                 begin.to_unix(),
                 end.to_unix(),
-                m_cancellable.get(),
+                subtask->cancellable.get(),
                 on_event_generated,
-                new ClientSubtask(main_task, client, m_cancellable, color),
+                subtask,
                 on_event_generated_list_ready);
         }
+
+        // don't make the indexed sources wait for the ones we're generating
+        if (waiting && !main_task->appointments.empty())
+            main_task->func(main_task->appointments, false);
     }
 
     void disable_ubuntu_alarm(const Appointment& appointment)
     {
         if (appointment.is_ubuntu_alarm())
         {
+            // we know which source the alarm came from, so just ask it
+            auto sit = m_sources_by_uid.find(appointment.source_uid);
+            auto cit = sit != m_sources_by_uid.end() ? m_clients.find(sit->second) : m_clients.end();
+            if (cit != m_clients.end())
+            {
+                e_cal_client_get_object(cit->second,
+                                        appointment.uid.c_str(),
+                                        nullptr,
+                                        m_cancellable.get(),
+                                        on_object_ready_for_disable,
+                                        this);
+                return;
+            }
+
+            g_debug("no client for source '%s'; asking them all", appointment.source_uid.c_str());
             for (auto& kv : m_clients) // find the matching icalcomponent
             {
                 e_cal_client_get_object(kv.second,
@@ -154,22 +234,68 @@ public:
         }
     }
 
+    void watch_range(const void* key, const DateTime& begin, const DateTime& end)
+    {
+        m_watched[key] = std::make_pair(begin, end);
+        update_view_window_soon();
+    }
+
+    void unwatch_range(const void* key)
+    {
+        if (m_watched.erase(key))
+            update_view_window_soon();
+    }
+
 private:
 
-    void set_dirty_now()
+    /***
+    ****  Startup
+    ****
+    ****  Hold get_appointments() requests until the source registry is
+    ****  loaded and the initial clients have connected, so that callers
+    ****  don't get a misleading empty list while EDS is starting up.
+    ***/
+
+    static constexpr int MAX_STARTUP_SEC = 10;
+
+    bool is_ready() const
     {
-        m_changed();
+        return m_startup_done || (m_source_registry && !m_n_connecting);
+    }
+
+    void flush_deferred()
+    {
+        if (!is_ready())
+            return;
+
+        if (m_startup_tag)
+        {
+            g_source_remove(m_startup_tag);
+            m_startup_tag = 0;
+        }
+        m_startup_done = true;
+
+        auto deferred = std::move(m_deferred);
+        m_deferred.clear();
+        for (auto& func : deferred)
+            func();
     }
 
-    static gboolean set_dirty_now_static (gpointer gself)
+    static gboolean on_startup_timeout(gpointer gself)
     {
         auto self = static_cast<Impl*>(gself);
-        self->m_rebuild_tag = 0;
-        self->m_rebuild_deadline = 0;
-        self->set_dirty_now();
+        g_debug("EDS is slow to start; no longer waiting for it");
+        self->m_startup_tag = 0;
+        self->m_startup_done = true;
+        self->flush_deferred();
         return G_SOURCE_REMOVE;
     }
 
+    void set_dirty_now()
+    {
+        m_changed();
+    }
+
     void set_dirty_soon()
     {
         static constexpr int MIN_BATCH_SEC = 1;
@@ -181,15 +307,27 @@ private:
         if (m_rebuild_deadline == 0) // first pass
         {
             m_rebuild_deadline = now + MAX_BATCH_SEC;
-            m_rebuild_tag = g_timeout_add_seconds(MIN_BATCH_SEC, set_dirty_now_static, this);
+            start_rebuild_timer(MIN_BATCH_SEC);
         }
         else if (now < m_rebuild_deadline)
         {
-            g_source_remove (m_rebuild_tag);
-            m_rebuild_tag = g_timeout_add_seconds(MIN_BATCH_SEC, set_dirty_now_static, this);
+            TimerService::get_default().remove(m_rebuild_tag);
+            start_rebuild_timer(MIN_BATCH_SEC);
         }
     }
 
+    void start_rebuild_timer(int seconds)
+    {
+        // nobody's waiting on the exact second, so let it share a wakeup
+        static constexpr GTimeSpan TOLERANCE_USEC {G_TIME_SPAN_SECOND};
+
+        m_rebuild_tag = TimerService::get_default().add(seconds * G_TIME_SPAN_SECOND, TOLERANCE_USEC, [this](){
+            m_rebuild_tag = 0;
+            m_rebuild_deadline = 0;
+            set_dirty_now();
+        });
+    }
+
     static void on_source_registry_ready(GObject* /*source*/, GAsyncResult* res, gpointer gself)
     {
         GError * error = nullptr;
@@ -197,7 +335,12 @@ private:
         if (error != nullptr)
         {
             if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
                 g_warning("indicator-datetime cannot show EDS appointments: %s", error->message);
+                auto self = static_cast<Impl*>(gself);
+                self->m_startup_done = true;
+                self->flush_deferred();
+            }
 
             g_error_free(error);
         }
@@ -213,6 +356,7 @@ private:
             self->m_source_registry = r;
             self->add_sources_by_extension(E_SOURCE_EXTENSION_CALENDAR);
             self->add_sources_by_extension(E_SOURCE_EXTENSION_TASK_LIST);
+            self->flush_deferred();
         }
     }
 
@@ -230,6 +374,7 @@ private:
         auto self = static_cast<Impl*>(gself);
 
         self->m_sources.insert(E_SOURCE(g_object_ref(source)));
+        self->m_sources_by_uid[e_source_get_uid(source)] = source;
 
         if (e_source_get_enabled(source))
             on_source_enabled(registry, source, gself);
@@ -256,6 +401,7 @@ private:
         if (client_wanted)
         {
             g_debug("%s connecting a client to source %s", G_STRFUNC, source_uid);
+            ++self->m_n_connecting;
             e_cal_client_connect(source,
                                  source_type,
 #if EDS_CHECK_VERSION(3,13,90)
@@ -278,7 +424,12 @@ private:
         if (error)
         {
             if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
                 g_warning("indicator-datetime cannot connect to EDS source: %s", error->message);
+                auto self = static_cast<Impl*>(gself);
+                --self->m_n_connecting;
+                self->flush_deferred();
+            }
 
             g_error_free(error);
         }
@@ -286,6 +437,7 @@ private:
         {
             // add the client to our collection
             auto self = static_cast<Impl*>(gself);
+            --self->m_n_connecting;
             g_debug("got a client for %s", e_cal_client_get_local_attachment_store(E_CAL_CLIENT(client)));
             auto source = e_client_get_source(client);
             auto ecc = E_CAL_CLIENT(client);
@@ -295,13 +447,14 @@ private:
 
             // now create a view for it so that we can listen for changes
             e_cal_client_get_view (ecc,
-                                   "#t", // match all
+                                   self->m_view_sexp.c_str(),
                                    self->m_cancellable.get(),
                                    on_client_view_ready,
                                    self);
 
             g_debug("client connected; calling set_dirty_soon()");
             self->set_dirty_soon();
+            self->flush_deferred();
         }
     }
 
@@ -317,13 +470,19 @@ private:
             e_cal_client_view_start(view, &error);
             g_debug("got a view for %s", e_cal_client_get_local_attachment_store(E_CAL_CLIENT(client)));
             auto self = static_cast<Impl*>(gself);
-            self->m_views[e_client_get_source(E_CLIENT(client))] = view;
+            auto source = e_client_get_source(E_CLIENT(client));
+            self->remove_view(source); // if the window moved twice, keep the newest
+            self->m_views[source] = view;
 
             g_signal_connect(view, "objects-added", G_CALLBACK(on_view_objects_added), self);
             g_signal_connect(view, "objects-modified", G_CALLBACK(on_view_objects_modified), self);
             g_signal_connect(view, "objects-removed", G_CALLBACK(on_view_objects_removed), self);
-            g_debug("view connected; calling set_dirty_soon()");
-            self->set_dirty_soon();
+            g_signal_connect(view, "complete", G_CALLBACK(on_view_complete), self);
+            if (!self->m_populating.count(source))
+            {
+                g_debug("view connected; calling set_dirty_soon()");
+                self->set_dirty_soon();
+            }
         }
         else if(error != nullptr)
         {
@@ -334,20 +493,49 @@ private:
         }
     }
 
-    static void on_view_objects_added(ECalClientView* /*view*/, gpointer /*objects*/, gpointer gself)
+    static void on_view_objects_added(ECalClientView* view, gpointer objects, gpointer gself)
     {
         g_debug("%s", G_STRFUNC);
-        static_cast<Impl*>(gself)->set_dirty_soon();
+        static_cast<Impl*>(gself)->on_view_objects_changed(view, static_cast<const GSList*>(objects));
     }
-    static void on_view_objects_modified(ECalClientView* /*view*/, gpointer /*objects*/, gpointer gself)
+    static void on_view_objects_modified(ECalClientView* view, gpointer objects, gpointer gself)
     {
         g_debug("%s", G_STRFUNC);
-        static_cast<Impl*>(gself)->set_dirty_soon();
+        static_cast<Impl*>(gself)->on_view_objects_changed(view, static_cast<const GSList*>(objects));
     }
-    static void on_view_objects_removed(ECalClientView* /*view*/, gpointer /*objects*/, gpointer gself)
+    static void on_view_objects_removed(ECalClientView* view, gpointer ids, gpointer gself)
     {
         g_debug("%s", G_STRFUNC);
-        static_cast<Impl*>(gself)->set_dirty_soon();
+        static_cast<Impl*>(gself)->on_view_objects_removed(view, static_cast<const GSList*>(ids));
+    }
+
+    static void on_view_complete(ECalClientView* view, const GError* /*error*/, gpointer gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+        auto source = self->source_from_view(view);
+        if (self->m_populating.erase(source))
+        {
+            // changes made while the view was being re-issued were hidden
+            // in its initial burst, so the index may have missed them
+            g_debug("re-issued view for %s is populated; calling set_dirty_soon()", e_source_get_display_name(source));
+            self->invalidate_index(source);
+            self->set_dirty_soon();
+        }
+    }
+
+    bool remove_view(ESource* source)
+    {
+        auto vit = m_views.find(source);
+        if (vit == m_views.end())
+            return false;
+
+        auto& view = vit->second;
+        e_cal_client_view_stop(view, nullptr);
+        const auto n_disconnected = g_signal_handlers_disconnect_by_data(view, this);
+        g_warn_if_fail(n_disconnected == 4);
+        g_object_unref(view);
+        m_views.erase(vit);
+        return true;
     }
 
     static void on_source_disabled(ESourceRegistry* /*registry*/, ESource* source, gpointer gself)
@@ -356,24 +544,21 @@ private:
     }
     void disable_source(ESource* source)
     {
+        invalidate_index(source);
+
         // if an ECalClientView is associated with this source, remove it
-        auto vit = m_views.find(source);
-        if (vit != m_views.end())
-        {
-            auto& view = vit->second;
-            e_cal_client_view_stop(view, nullptr);
-            const auto n_disconnected = g_signal_handlers_disconnect_by_data(view, this);
-            g_warn_if_fail(n_disconnected == 3);
-            g_object_unref(view);
-            m_views.erase(vit);
+        m_populating.erase(source);
+        if (remove_view(source))
             set_dirty_soon();
-        }
 
         // if an ECalClient is associated with this source, remove it
         auto cit = m_clients.find(source);
         if (cit != m_clients.end())
         {
             auto& client = cit->second;
+            m_client_timezones.erase(client);
+            m_pending_timezones.erase(client);
+            m_detached_instances.erase(client);
             g_object_unref(client);
             m_clients.erase(cit);
             set_dirty_soon();
@@ -391,16 +576,372 @@ private:
         auto sit = m_sources.find(source);
         if (sit != m_sources.end())
         {
+            auto uit = m_sources_by_uid.find(e_source_get_uid(source));
+            if ((uit != m_sources_by_uid.end()) && (uit->second == source))
+                m_sources_by_uid.erase(uit);
             g_object_unref(*sit);
             m_sources.erase(sit);
             set_dirty_soon();
         }
     }
 
-    static void on_source_changed(ESourceRegistry* /*registry*/, ESource* /*source*/, gpointer gself)
+    static void on_source_changed(ESourceRegistry* /*registry*/, ESource* source, gpointer gself)
     {
         g_debug("source changed; calling set_dirty_soon()");
-        static_cast<Impl*>(gself)->set_dirty_soon();
+        auto self = static_cast<Impl*>(gself);
+        self->invalidate_index(source); // its color or selection may have changed
+        self->set_dirty_soon();
+    }
+
+    /***
+    ****  View Window
+    ****
+    ****  Rather than watching every component in every source, the views
+    ****  only match components that occur in the planners' watched ranges,
+    ****  so edits to far-away events don't wake us up. When the watched
+    ****  ranges move, e.g. at midnight or when the calendar is paged,
+    ****  the views are re-issued with the new window.
+    ***/
+
+    typedef std::pair<DateTime,DateTime> Range;
+
+    // the union of the watched ranges, sorted and disjoint
+    std::vector<Range> get_view_window() const
+    {
+        std::vector<Range> ranges;
+        for (const auto& kv : m_watched)
+            ranges.push_back(kv.second);
+        std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b){return a.first < b.first;});
+
+        std::vector<Range> merged;
+        for (const auto& range : ranges)
+        {
+            if (!merged.empty() && !(merged.back().second < range.first))
+            {
+                if (merged.back().second < range.second)
+                    merged.back().second = range.second;
+            }
+            else
+            {
+                merged.push_back(range);
+            }
+        }
+        return merged;
+    }
+
+    static std::string create_view_sexp(const std::vector<Range>& window)
+    {
+        if (window.empty())
+            return "#t"; // match all
+
+        std::string sexp = "(or";
+        for (const auto& range : window)
+        {
+            auto begin = isodate_from_time_t(range.first.to_unix());
+            auto end = isodate_from_time_t(range.second.to_unix());
+            sexp += " (occur-in-time-range? (make-time \"";
+            sexp += begin;
+            sexp += "\") (make-time \"";
+            sexp += end;
+            sexp += "\"))";
+            g_free(begin);
+            g_free(end);
+        }
+        sexp += ")";
+        return sexp;
+    }
+
+    void update_view_window_soon()
+    {
+        static constexpr int WINDOW_BATCH_SEC = 1;
+
+        static constexpr GTimeSpan TOLERANCE_USEC {G_TIME_SPAN_SECOND};
+
+        if (m_window_tag == 0)
+            m_window_tag = TimerService::get_default().add(WINDOW_BATCH_SEC * G_TIME_SPAN_SECOND, TOLERANCE_USEC, [this](){
+                m_window_tag = 0;
+                update_view_window();
+            });
+    }
+
+    void update_view_window()
+    {
+        const auto window = get_view_window();
+        auto sexp = create_view_sexp(window);
+        if (sexp == m_view_sexp)
+            return;
+
+        g_debug("re-issuing views with %s", sexp.c_str());
+        m_view_sexp = sexp;
+
+        // the views won't tell us about changes outside of the window,
+        // so an index that reaches outside of it can't be trusted anymore
+        std::vector<ESource*> stale;
+        for (const auto& kv : m_indices)
+        {
+            const auto& index = kv.second;
+            auto within = [&index](const Range& r){return (r.first <= index.begin) && (index.end <= r.second);};
+            if (!window.empty() && std::none_of(window.begin(), window.end(), within))
+                stale.push_back(kv.first);
+        }
+        for (auto& source : stale)
+            invalidate_index(source);
+
+        for (auto& kv : m_clients)
+        {
+            auto& source = kv.first;
+
+            // The new view starts with a burst of "objects-added" for
+            // everything in the window. Those aren't changes, so ignore
+            // them until it says it's complete.
+            if (remove_view(source))
+                m_populating.insert(source);
+
+            e_cal_client_get_view(kv.second,
+                                  m_view_sexp.c_str(),
+                                  m_cancellable.get(),
+                                  on_client_view_ready,
+                                  this);
+        }
+    }
+
+    /***
+    ****  Appointment Index
+    ****
+    ****  We keep the appointments generated for each source, keyed by
+    ****  component uid, so that the ECalClientView's deltas can be patched
+    ****  in one component at a time instead of regenerating every instance
+    ****  in the planners' ranges.
+    ***/
+
+    struct SourceIndex
+    {
+        DateTime begin;
+        DateTime end;
+        std::string timezone;
+        unsigned int epoch {};
+        std::map<std::string,std::vector<Appointment>> appointments; // uid -> instances
+        std::map<std::string,unsigned int> uid_serials; // uid -> latest reindex or removal
+
+        bool covers(const DateTime& b, const DateTime& e, const std::string& tz) const
+        {
+            return (timezone == tz) && (begin <= b) && (e <= end);
+        }
+
+        void get_appointments(const DateTime& b, const DateTime& e, std::vector<Appointment>& setme) const
+        {
+            for (const auto& kv : appointments)
+                for (const auto& appointment : kv.second)
+                    if (!(appointment.end < b) && !(e < appointment.begin))
+                        setme.push_back(appointment);
+        }
+
+        void add(const std::vector<Appointment>& in)
+        {
+            for (const auto& appointment : in)
+            {
+                // fold in the instances we don't already have
+                auto& instances = appointments[appointment.uid];
+                auto it = std::find_if(instances.begin(), instances.end(), [&appointment](const Appointment& a){
+                    return (a.begin == appointment.begin) && (a.end == appointment.end);
+                });
+                if (it == instances.end())
+                    instances.push_back(appointment);
+                else if (it->alarms.size() < appointment.alarms.size())
+                    *it = appointment;
+            }
+        }
+    };
+
+    void invalidate_index(ESource* source)
+    {
+        ++m_index_serials[source];
+        m_indices.erase(source);
+    }
+
+    void invalidate_all_indices()
+    {
+        for (auto& kv : m_index_serials)
+            ++kv.second;
+        m_indices.clear();
+    }
+
+    // called when a full fetch of [begin..end] for a source has finished
+    void add_to_index(ESource                         * source,
+                      unsigned int                      serial,
+                      const DateTime                  & begin,
+                      const DateTime                  & end,
+                      const std::string               & timezone,
+                      const std::vector<Appointment>  & appointments)
+    {
+        // if the source changed while we were waiting, the results are stale
+        if (!m_clients.count(source) || (m_index_serials[source] != serial))
+            return;
+
+        auto it = m_indices.find(source);
+        const bool contiguous = (it != m_indices.end())
+                             && (it->second.timezone == timezone)
+                             && !(it->second.end < begin)
+                             && !(end < it->second.begin);
+
+        if (contiguous) // grow the existing index to cover both ranges
+        {
+            auto& index = it->second;
+            if (begin < index.begin)
+                index.begin = begin;
+            if (index.end < end)
+                index.end = end;
+            index.add(appointments);
+        }
+        else // start a new index
+        {
+            auto& index = m_indices[source];
+            index = SourceIndex();
+            index.begin = begin;
+            index.end = end;
+            index.timezone = timezone;
+            index.epoch = serial;
+            index.add(appointments);
+        }
+    }
+
+    ESource* source_from_view(ECalClientView* view) const
+    {
+        for (const auto& kv : m_views)
+            if (kv.second == view)
+                return kv.first;
+        return nullptr;
+    }
+
+    void on_view_objects_changed(ECalClientView* view, const GSList* icalcomponents)
+    {
+        // past this size it's cheaper to regenerate the whole range,
+        // e.g. the view's initial burst of "objects-added" after it starts
+        static constexpr guint MAX_PATCHES = 32;
+
+        auto source = source_from_view(view);
+        auto cit = m_clients.find(source);
+        if ((source != nullptr) && (cit != m_clients.end()))
+        {
+            if (m_populating.count(source))
+            {
+                for (auto l=icalcomponents; l!=nullptr; l=l->next)
+                    prefetch_timezones(cit->second, static_cast<icalcomponent*>(l->data));
+                return;
+            }
+
+            for (auto l=icalcomponents; l!=nullptr; l=l->next)
+            {
+                auto icc = static_cast<icalcomponent*>(l->data);
+                prefetch_timezones(cit->second, icc);
+                forget_detached_instances(cit->second, icalcomponent_get_uid(icc));
+            }
+
+            ++m_index_serials[source];
+
+            if (g_slist_length(const_cast<GSList*>(icalcomponents)) > MAX_PATCHES)
+                invalidate_index(source);
+            else for (auto l=icalcomponents; l!=nullptr; l=l->next)
+                reindex_component(source, cit->second, static_cast<icalcomponent*>(l->data));
+        }
+
+        set_dirty_soon();
+    }
+
+    void on_view_objects_removed(ECalClientView* view, const GSList* ids)
+    {
+        auto source = source_from_view(view);
+        if (source != nullptr)
+        {
+            ++m_index_serials[source];
+
+            auto cit = m_clients.find(source);
+            if (cit != m_clients.end())
+                for (auto l=ids; l!=nullptr; l=l->next)
+                    forget_detached_instances(cit->second, static_cast<const ECalComponentId*>(l->data)->uid);
+
+            for (auto l=ids; l!=nullptr; l=l->next)
+            {
+                auto iit = m_indices.find(source);
+                if (iit == m_indices.end())
+                    break;
+
+                auto id = static_cast<const ECalComponentId*>(l->data);
+                if ((id->rid != nullptr) && (*id->rid != '\0'))
+                    invalidate_index(source); // a detached instance; regenerate its series
+                else if (id->uid != nullptr)
+                {
+                    iit->second.appointments.erase(id->uid);
+                    ++iit->second.uid_serials[id->uid]; // don't let an older reindex bring it back
+                }
+            }
+        }
+
+        set_dirty_soon();
+    }
+
+    void reindex_component(ESource* source, ECalClient* client, icalcomponent* icc)
+    {
+        auto iit = m_indices.find(source);
+        if (iit == m_indices.end())
+            return;
+
+        const auto uid = icalcomponent_get_uid(icc);
+        if ((uid == nullptr) || !icaltime_is_null_time(icalcomponent_get_recurrenceid(icc)))
+        {
+            // a detached instance affects the rest of its series,
+            // so just regenerate the source
+            invalidate_index(source);
+            return;
+        }
+
+        auto& index = iit->second;
+        icaltimezone* default_timezone {};
+        auto gtz = lookup_timezone(index.timezone.c_str(), nullptr, &default_timezone);
+        gtz = gtz ? g_time_zone_ref(gtz) : g_time_zone_new_local();
+
+        const std::string uid_str {uid};
+        const auto epoch = index.epoch;
+        const auto serial = ++index.uid_serials[uid_str];
+        const auto begin = index.begin;
+        const auto end = index.end;
+        auto on_reindexed = [this, source, epoch, serial, begin, end, uid_str](const std::vector<Appointment>& appointments, bool done){
+            if (!done)
+                return; // wait for the complete list of instances
+            auto it = m_indices.find(source);
+            if ((it == m_indices.end()) || (it->second.epoch != epoch))
+                return;
+            auto& current = it->second;
+            if (current.uid_serials[uid_str] != serial)
+                return; // a newer reindex or removal of this uid wins
+            if ((current.begin != begin) || (current.end != end))
+            {
+                // the index grew while we were waiting, so these
+                // instances don't cover all of it anymore
+                invalidate_index(source);
+                set_dirty_soon();
+                return;
+            }
+            g_debug("reindexed '%s': %zu instances", uid_str.c_str(), appointments.size());
+            if (appointments.empty())
+                current.appointments.erase(uid_str);
+            else
+                current.appointments[uid_str] = appointments;
+            set_dirty_soon();
+        };
+
+        auto task = std::make_shared<Task>(this, on_reindexed, m_cancellable, default_timezone, gtz, index.begin, index.end);
+        auto extension = e_source_get_extension(source, E_SOURCE_EXTENSION_CALENDAR);
+        const auto color = e_source_selectable_get_color(E_SOURCE_SELECTABLE(extension));
+        e_cal_client_generate_instances_for_object(
+            client,
+            icc,
+            index.begin.to_unix(),
+            index.end.to_unix(),
+            m_cancellable.get(),
+            on_event_generated,
+            new ClientSubtask(task, client, color),
+            on_event_generated_list_ready);
     }
 
     /***
@@ -534,10 +1075,40 @@ private:
 
     typedef std::function<void(const std::vector<Appointment>&)> appointment_func;
 
+    static void on_parent_cancelled(GCancellable* /*parent*/, gpointer gchild)
+    {
+        g_cancellable_cancel(G_CANCELLABLE(gchild));
+    }
+
+    // returns a GCancellable that gets cancelled when any of its parents are
+    static std::shared_ptr<GCancellable> create_cancellable(const std::vector<GCancellable*>& parents)
+    {
+        auto child = g_cancellable_new();
+
+        std::vector<std::pair<GCancellable*,gulong>> links;
+        for (auto parent : parents)
+        {
+            if (parent == nullptr)
+                continue;
+            const auto tag = g_cancellable_connect(parent, G_CALLBACK(on_parent_cancelled), child, nullptr);
+            links.push_back(std::make_pair(G_CANCELLABLE(g_object_ref(parent)), tag));
+        }
+
+        return std::shared_ptr<GCancellable>(child, [links](GCancellable* c){
+            for (auto& link : links)
+            {
+                g_cancellable_disconnect(link.first, link.second);
+                g_object_unref(link.first);
+            }
+            g_object_unref(c);
+        });
+    }
+
     struct Task
     {
         Impl* p;
-        appointment_func func;
+        appointment_batch_func func;
+        std::shared_ptr<GCancellable> cancellable;
         icaltimezone* default_timezone; // pointer owned by libical
         GTimeZone* gtz;
         std::vector<Appointment> appointments;
@@ -545,24 +1116,34 @@ private:
         const DateTime end;
 
         Task(Impl* p_in,
-             appointment_func func_in,
+             appointment_batch_func func_in,
+             const std::shared_ptr<GCancellable>& cancellable_in,
              icaltimezone* tz_in,
              GTimeZone* gtz_in,
              const DateTime& begin_in,
              const DateTime& end_in):
                  p{p_in},
                  func{func_in},
+                 cancellable{cancellable_in},
                  default_timezone{tz_in},
                  gtz{gtz_in},
                  begin{begin_in},
                  end{end_in} {}
 
+        bool is_cancelled() const {
+            return g_cancellable_is_cancelled(cancellable.get());
+        }
+
         ~Task() {
             g_clear_pointer(&gtz, g_time_zone_unref);
+            if (is_cancelled()) {
+                g_debug("abandoning cancelled task");
+                return;
+            }
             // give the caller the sorted finished product
             auto& a = appointments;
             std::sort(a.begin(), a.end(), [](const Appointment& a, const Appointment& b){return a.begin < b.begin;});
-            func(a);
+            func(a, true);
         };
     };
 
@@ -575,14 +1156,15 @@ private:
         GList *components;
         GList *instance_components;
         std::set<std::string> parent_components;
+        std::vector<Appointment> appointments;
+        appointment_func index_func;
 
         ClientSubtask(const std::shared_ptr<Task>& task_in,
                       ECalClient* client_in,
-                      const std::shared_ptr<GCancellable>& cancellable_in,
                       const char* color_in):
             task(task_in),
             client(client_in),
-            cancellable(cancellable_in),
+            cancellable(task_in->cancellable),
             components(nullptr),
             instance_components(nullptr)
         {
@@ -654,15 +1236,43 @@ private:
         } else {
             subtask->components = g_list_append(subtask->components, comp);
         }
-        return TRUE;
+
+        // stop generating if nobody wants the results anymore
+        return !subtask->task->is_cancelled();
+    }
+
+    /***
+    ****  Detached instances
+    ****
+    ****  A recurring series can have individually-modified instances that
+    ****  generate_instances() doesn't give us. We cache each client's
+    ****  detached instances by series uid, drop them when the view reports
+    ****  a change to that uid, and fetch whatever's missing in one query.
+    ***/
+
+    typedef std::vector<std::shared_ptr<ECalComponent>> ComponentList;
+    typedef std::map<std::string,ComponentList> DetachedInstanceMap; // series uid -> instances
+
+    void forget_detached_instances(ECalClient* client, const char* uid)
+    {
+        auto it = m_detached_instances.find(client);
+        if ((it != m_detached_instances.end()) && (uid != nullptr))
+            it->second.erase(uid);
+    }
+
+    ESource* source_from_client(ECalClient* client) const
+    {
+        for (const auto& kv : m_clients)
+            if (kv.second == client)
+                return kv.first;
+        return nullptr;
     }
 
     static void
-    merge_detached_instances(ClientSubtask *subtask, GSList *instances)
+    merge_detached_instances(ClientSubtask *subtask, const ComponentList& instances)
     {
-        for (GSList *i=instances; i!=nullptr; i=i->next) {
-            auto instance = static_cast<ECalComponent*>(i->data);
-            auto instance_id = e_cal_component_get_id(instance);
+        for (const auto& instance : instances) {
+            auto instance_id = e_cal_component_get_id(instance.get());
             for (GList *c=subtask->instance_components ; c!= nullptr; c=c->next) {
                 auto component = static_cast<ECalComponent*>(c->data);
                 auto component_id = e_cal_component_get_id(component);
@@ -671,7 +1281,7 @@ private:
                 if (e_cal_component_id_equal(instance_id, component_id)) {
                     // replaces virtual instance with the real one
                     g_object_unref(component);
-                    c->data = g_object_ref(instance);
+                    c->data = g_object_ref(instance.get());
                     found = true;
                 }
                 e_cal_component_free_id(component_id);
@@ -682,48 +1292,98 @@ private:
         }
     }
 
+    static std::string
+    quote_sexp_string(const std::string& in)
+    {
+        std::string out {"\""};
+        for (const auto ch : in) {
+            if ((ch == '"') || (ch == '\\'))
+                out += '\\';
+            out += ch;
+        }
+        out += '"';
+        return out;
+    }
+
     static void
-    fetch_detached_instances(GObject *,
-                              GAsyncResult *res,
-                              gpointer gsubtask)
+    on_event_generated_list_ready(gpointer gsubtask)
     {
         auto subtask = static_cast<ClientSubtask*>(gsubtask);
-        if (res) {
-            GError *error = nullptr;
-            GSList *comps = nullptr;
-            e_cal_client_get_objects_for_uid_finish(subtask->client,
-                                                    res,
-                                                    &comps,
-                                                    &error);
-            if (error) {
-                g_warning("Fail to retrieve detached instances: %s", error->message);
-                g_error_free(error);
-            } else {
-                merge_detached_instances(subtask, comps);
-                e_cal_client_free_ecalcomp_slist(comps);
+        if (subtask->parent_components.empty() || subtask->task->is_cancelled()) {
+            on_event_fetch_list_done(gsubtask);
+            return;
+        }
+
+        // use the detached instances we already know about...
+        auto p = subtask->task->p;
+        std::string sexp;
+        auto cit = p->m_detached_instances.find(subtask->client);
+        for (const auto& uid : subtask->parent_components) {
+            if (cit != p->m_detached_instances.end()) {
+                auto it = cit->second.find(uid);
+                if (it != cit->second.end()) {
+                    merge_detached_instances(subtask, it->second);
+                    continue;
+                }
             }
+            sexp += " (uid? " + quote_sexp_string(uid) + ")";
         }
 
-        if (subtask->parent_components.empty()) {
+        if (sexp.empty()) {
             on_event_fetch_list_done(gsubtask);
             return;
         }
 
-        // continue fetch detached instances
-        auto i_begin = subtask->parent_components.begin();
-        std::string id = *i_begin;
-        subtask->parent_components.erase(i_begin);
-        e_cal_client_get_objects_for_uid(subtask->client,
-                                         id.c_str(),
-                                         subtask->cancellable.get(),
-                                         (GAsyncReadyCallback) fetch_detached_instances,
-                                         gsubtask);
+        // ...and fetch the rest in a single batch
+        sexp = "(or" + sexp + ")";
+        g_debug("fetching detached instances: %s", sexp.c_str());
+        e_cal_client_get_object_list_as_comps(subtask->client,
+                                              sexp.c_str(),
+                                              subtask->cancellable.get(),
+                                              on_detached_instances_fetched,
+                                              gsubtask);
     }
 
     static void
-    on_event_generated_list_ready(gpointer gsubtask)
+    on_detached_instances_fetched(GObject      * /*oclient*/,
+                                  GAsyncResult * res,
+                                  gpointer       gsubtask)
     {
-        fetch_detached_instances(nullptr, nullptr, gsubtask);
+        auto subtask = static_cast<ClientSubtask*>(gsubtask);
+        GError *error = nullptr;
+        GSList *comps = nullptr;
+
+        if (e_cal_client_get_object_list_as_comps_finish(subtask->client, res, &comps, &error)) {
+            auto p = subtask->task->p;
+
+            // group them by series, remembering the series that have none
+            DetachedInstanceMap fetched;
+            auto cit = p->m_detached_instances.find(subtask->client);
+            for (const auto& uid : subtask->parent_components)
+                if ((cit == p->m_detached_instances.end()) || !cit->second.count(uid))
+                    fetched[uid];
+            for (auto l=comps; l!=nullptr; l=l->next) {
+                auto comp = E_CAL_COMPONENT(l->data);
+                const gchar* uid = nullptr;
+                e_cal_component_get_uid(comp, &uid);
+                if ((uid != nullptr) && e_cal_component_is_instance(comp) && fetched.count(uid))
+                    fetched[uid].push_back(std::shared_ptr<ECalComponent>(E_CAL_COMPONENT(g_object_ref(comp)), g_object_unref));
+            }
+            e_cal_client_free_ecalcomp_slist(comps);
+
+            const bool cacheable = p->source_from_client(subtask->client) != nullptr;
+            for (auto& kv : fetched) {
+                merge_detached_instances(subtask, kv.second);
+                if (cacheable)
+                    p->m_detached_instances[subtask->client][kv.first] = kv.second;
+            }
+        } else if (error != nullptr) {
+            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                g_warning("Fail to retrieve detached instances: %s", error->message);
+            g_error_free(error);
+        }
+
+        on_event_fetch_list_done(gsubtask);
     }
 
     static gint
@@ -789,6 +1449,14 @@ private:
     {
         auto subtask = static_cast<ClientSubtask*>(gsubtask);
 
+        // if nobody wants the results anymore, don't bother building them
+        if (subtask->task->is_cancelled()) {
+            g_list_free_full(subtask->components, g_object_unref);
+            g_list_free_full(subtask->instance_components, g_object_unref);
+            delete subtask;
+            return;
+        }
+
         // generate alarms
         constexpr std::array<ECalComponentAlarmAction,1> omit = {
             (ECalComponentAlarmAction)-1
@@ -803,8 +1471,8 @@ private:
             subtask->task->end.to_unix(),
             const_cast<ECalComponentAlarmAction*>(omit.data()),
             &comp_alarms,
-            e_cal_client_resolve_tzid_cb,
-            subtask->client,
+            resolve_tzid,
+            subtask,
             nullptr);
 
         // convert timezone for non-instance events
@@ -814,8 +1482,8 @@ private:
             subtask->task->end.to_unix(),
             const_cast<ECalComponentAlarmAction*>(omit.data()),
             &comp_alarms,
-            e_cal_client_resolve_tzid_cb,
-            subtask->client,
+            resolve_tzid,
+            subtask,
             subtask->task->default_timezone);
 
         // walk the alarms & add them
@@ -832,30 +1500,42 @@ private:
         }
         g_list_free_full(subtask->components, g_object_unref);
         e_cal_free_alarms(comp_alarms);
+
+        // hand the results to the task, and to the index if it wants them
+        if (subtask->index_func)
+            subtask->index_func(subtask->appointments);
+        if (!subtask->appointments.empty() && !subtask->task->is_cancelled())
+            subtask->task->func(subtask->appointments, false); // don't wait for the slower sources
+        auto& task_appointments = subtask->task->appointments;
+        task_appointments.insert(task_appointments.end(),
+                                 subtask->appointments.begin(),
+                                 subtask->appointments.end());
         delete subtask;
     }
 
-    static GTimeZone *
-    timezone_from_name (const char * tzid,
-                        ECalClient * client,
-                        GCancellable * cancellable,
-                        icaltimezone **itimezone)
-    {
-        if (tzid == nullptr)
-            return nullptr;
+    /***
+    ****  Timezones
+    ****
+    ****  Converting a calendar looks up the same handful of TZIDs over
+    ****  and over, so we intern each GTimeZone/icaltimezone pair once.
+    ****  Builtin zones are shared by every client; VTIMEZONEs defined
+    ****  by a calendar are fetched asynchronously from its client.
+    ***/
 
-        auto itz = icaltimezone_get_builtin_timezone_from_tzid(tzid); // usually works
+    struct InternedTimezone
+    {
+        std::shared_ptr<GTimeZone> gtz; // null if the TZID is unusable
+        icaltimezone* itz {}; // owned by libical or by the ECalClient
+    };
 
-        if (itz == nullptr) // fallback
-            itz = icaltimezone_get_builtin_timezone(tzid);
+    typedef std::map<std::string,InternedTimezone> TimezoneMap;
 
-        if (client && (itz == nullptr)) // ok we have a strange tzid... ask EDS to look it up in VTIMEZONES
-            e_cal_client_get_timezone_sync(client, tzid, &itz, cancellable, nullptr);
+    static InternedTimezone intern_timezone(const char* tzid, icaltimezone* itz)
+    {
+        InternedTimezone ret;
+        ret.itz = itz;
 
         const char* identifier {};
-        if (itimezone)
-            *itimezone = itz;
-
         if (itz != nullptr)
         {
             identifier = icaltimezone_get_display_name(itz);
@@ -881,23 +1561,175 @@ private:
         if (identifier == nullptr)
             g_warning("Unrecognized TZID: '%s'", tzid);
         else
-            return g_time_zone_new(identifier);
+            ret.gtz.reset(g_time_zone_new(identifier), g_time_zone_unref);
 
-        return nullptr;
+        return ret;
+    }
+
+    /**
+     * Returns the GTimeZone for a TZID, or nullptr if it's unknown.
+     *
+     * This never blocks. If the TZID is neither builtin nor already fetched
+     * from the client's VTIMEZONEs, a fetch is started and nullptr is returned
+     * so that the caller falls back to its default timezone for now.
+     */
+    GTimeZone* lookup_timezone(const char   * tzid,
+                               ECalClient   * client,
+                               icaltimezone ** itimezone)
+    {
+        if (itimezone)
+            *itimezone = nullptr;
+
+        if (tzid == nullptr)
+            return nullptr;
+
+        const InternedTimezone* zone {};
+
+        auto bit = m_builtin_timezones.find(tzid);
+        if (bit != m_builtin_timezones.end())
+        {
+            zone = &bit->second;
+        }
+        else
+        {
+            auto itz = icaltimezone_get_builtin_timezone_from_tzid(tzid); // usually works
+
+            if (itz == nullptr) // fallback
+                itz = icaltimezone_get_builtin_timezone(tzid);
+
+            if ((itz == nullptr) && !g_strcmp0(tzid, "UTC"))
+                itz = icaltimezone_get_utc_timezone();
+
+            if (itz != nullptr)
+            {
+                zone = &(m_builtin_timezones[tzid] = intern_timezone(tzid, itz));
+            }
+            else if (client != nullptr) // a strange tzid... look in the client's VTIMEZONEs
+            {
+                auto& client_zones = m_client_timezones[client];
+                auto cit = client_zones.find(tzid);
+                if (cit != client_zones.end())
+                    zone = &cit->second;
+                else
+                    fetch_timezone(client, tzid);
+            }
+            else
+            {
+                g_warning("Unrecognized TZID: '%s'", tzid);
+            }
+        }
+
+        if (zone == nullptr)
+            return nullptr;
+
+        if (itimezone)
+            *itimezone = zone->itz;
+        return zone->gtz.get();
     }
 
-    static DateTime
-    datetime_from_component_date_time(ECalClient                     * client,
-                                      std::shared_ptr<GCancellable>  & cancellable,
-                                      const ECalComponentDateTime    & in,
-                                      GTimeZone                      * default_timezone)
+    // an ECalRecurResolveTimezoneFn that uses our cache instead of blocking on EDS
+    static icaltimezone* resolve_tzid(const gchar* tzid, gpointer gsubtask)
+    {
+        auto subtask = static_cast<ClientSubtask*>(gsubtask);
+        icaltimezone* itz {};
+        subtask->task->p->lookup_timezone(tzid, subtask->client, &itz);
+        return itz;
+    }
+
+    // fetch the VTIMEZONEs of any unfamiliar TZIDs in this component
+    void prefetch_timezones(ECalClient* client, icalcomponent* icc)
+    {
+        for (auto kind : { ICAL_DTSTART_PROPERTY, ICAL_DTEND_PROPERTY })
+        {
+            auto prop = icalcomponent_get_first_property(icc, kind);
+            if (prop == nullptr)
+                continue;
+
+            auto param = icalproperty_get_first_parameter(prop, ICAL_TZID_PARAMETER);
+            if (param != nullptr)
+                lookup_timezone(icalparameter_get_tzid(param), client, nullptr);
+        }
+    }
+
+    struct TimezoneFetch
+    {
+        Impl* self;
+        ECalClient* client;
+        std::string tzid;
+    };
+
+    void fetch_timezone(ECalClient* client, const std::string& tzid)
+    {
+        auto& pending = m_pending_timezones[client];
+        if (!pending.insert(tzid).second) // already underway
+            return;
+
+        g_debug("fetching VTIMEZONE '%s'", tzid.c_str());
+        e_cal_client_get_timezone(client,
+                                  tzid.c_str(),
+                                  m_cancellable.get(),
+                                  on_timezone_ready,
+                                  new TimezoneFetch{this, client, tzid});
+    }
+
+    static void on_timezone_ready(GObject* oclient, GAsyncResult* res, gpointer gfetch)
+    {
+        auto fetch = static_cast<TimezoneFetch*>(gfetch);
+        icaltimezone* itz {};
+        GError* error {};
+
+        e_cal_client_get_timezone_finish(E_CAL_CLIENT(oclient), res, &itz, &error);
+        if (error != nullptr)
+        {
+            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
+                g_warning("Unrecognized TZID: '%s': %s", fetch->tzid.c_str(), error->message);
+                fetch->self->on_timezone_fetched(fetch->client, fetch->tzid, nullptr);
+            }
+
+            g_error_free(error);
+        }
+        else
+        {
+            fetch->self->on_timezone_fetched(fetch->client, fetch->tzid, itz);
+        }
+
+        delete fetch;
+    }
+
+    void on_timezone_fetched(ECalClient* client, const std::string& tzid, icaltimezone* itz)
+    {
+        m_pending_timezones[client].erase(tzid);
+
+        // if the client went away while we were waiting, there's nothing to do
+        auto cit = std::find_if(m_clients.begin(), m_clients.end(), [client](const std::pair<ESource* const,ECalClient*>& kv){
+            return kv.second == client;
+        });
+        if (cit == m_clients.end())
+            return;
+
+        // cache failures too, so that we don't keep asking
+        m_client_timezones[client][tzid] = itz ? intern_timezone(tzid.c_str(), itz) : InternedTimezone();
+
+        // anything already built with the fallback zone needs to be rebuilt
+        if (itz != nullptr)
+        {
+            invalidate_index(cit->first);
+            set_dirty_soon();
+        }
+    }
+
+    DateTime
+    datetime_from_component_date_time(ECalClient                  * client,
+                                      const ECalComponentDateTime & in,
+                                      GTimeZone                   * default_timezone)
     {
         DateTime out;
         g_return_val_if_fail(in.value != nullptr, out);
 
-        GTimeZone * gtz = timezone_from_name(in.tzid, client, cancellable.get(), nullptr);
+        GTimeZone * gtz = lookup_timezone(in.tzid, client, nullptr);
         if (gtz == nullptr)
-            gtz = g_time_zone_ref(default_timezone);
+            gtz = default_timezone;
 
         out = DateTime(gtz,
                        in.value->year,
@@ -906,7 +1738,6 @@ private:
                        in.value->hour,
                        in.value->minute,
                        in.value->second);
-        g_time_zone_unref(gtz);
         return out;
     }
 
@@ -964,11 +1795,10 @@ private:
         return true;
     }
 
-    static Appointment
-    get_appointment(ECalClient                    * client,
-                    std::shared_ptr<GCancellable> & cancellable,
-                    ECalComponent                 * component,
-                    GTimeZone                     * gtz)
+    Appointment
+    get_appointment(ECalClient    * client,
+                    ECalComponent * component,
+                    GTimeZone     * gtz)
     {
         Appointment baseline;
 
@@ -995,13 +1825,13 @@ private:
         // get appointment.begin
         ECalComponentDateTime eccdt_tmp {};
         e_cal_component_get_dtstart(component, &eccdt_tmp);
-        baseline.begin = datetime_from_component_date_time(client, cancellable, eccdt_tmp, gtz);
+        baseline.begin = datetime_from_component_date_time(client, eccdt_tmp, gtz);
         e_cal_component_free_datetime(&eccdt_tmp);
 
         // get appointment.end
         e_cal_component_get_dtend(component, &eccdt_tmp);
         baseline.end = eccdt_tmp.value != nullptr
-                                  ? datetime_from_component_date_time(client, cancellable, eccdt_tmp, gtz)
+                                  ? datetime_from_component_date_time(client, eccdt_tmp, gtz)
                                   : baseline.begin;
         e_cal_component_free_datetime(&eccdt_tmp);
 
@@ -1047,7 +1877,7 @@ private:
         if (!subtask->task->p->is_component_interesting(component))
             return;
 
-        Appointment baseline = get_appointment(subtask->client, subtask->cancellable, component, gtz);
+        Appointment baseline = subtask->task->p->get_appointment(subtask->client, component, gtz);
         baseline.color = subtask->color;
 
         /**
@@ -1106,7 +1936,7 @@ private:
                 if (j.second.has_text() || j.second.has_sound())
                     appointment.alarms.push_back(j.second);
             }
-            subtask->task->appointments.push_back(appointment);
+            subtask->appointments.push_back(appointment);
         }
     }
 
@@ -1119,9 +1949,9 @@ private:
         // add it. simple, eh?
         if (subtask->task->p->is_component_interesting(component))
         {
-            Appointment appointment = get_appointment(subtask->client, subtask->cancellable, component, gtz);
+            Appointment appointment = subtask->task->p->get_appointment(subtask->client, component, gtz);
             appointment.color = subtask->color;
-            subtask->task->appointments.push_back(appointment);
+            subtask->appointments.push_back(appointment);
         }
     }
 
@@ -1191,12 +2021,27 @@ private:
 
     core::Signal<> m_changed;
     std::set<ESource*> m_sources;
+    std::unordered_map<std::string,ESource*> m_sources_by_uid;
     std::map<ESource*,ECalClient*> m_clients;
     std::map<ESource*,ECalClientView*> m_views;
+    std::set<ESource*> m_populating;
+    std::map<const void*,Range> m_watched;
+    std::string m_view_sexp {"#t"};
+    guint m_window_tag {};
+    std::map<ESource*,SourceIndex> m_indices;
+    std::map<ESource*,unsigned int> m_index_serials;
+    TimezoneMap m_builtin_timezones;
+    std::map<ECalClient*,TimezoneMap> m_client_timezones;
+    std::map<ECalClient*,std::set<std::string>> m_pending_timezones;
+    std::map<ECalClient*,DetachedInstanceMap> m_detached_instances;
     std::shared_ptr<GCancellable> m_cancellable;
     ESourceRegistry* m_source_registry {};
     guint m_rebuild_tag {};
     time_t m_rebuild_deadline {};
+    guint m_startup_tag {};
+    bool m_startup_done {};
+    int m_n_connecting {};
+    std::vector<std::function<void()>> m_deferred;
     std::shared_ptr<Myself> m_myself;
 };
 
@@ -1219,9 +2064,22 @@ core::Signal<>& EdsEngine::changed()
 void EdsEngine::get_appointments(const DateTime& begin,
                                  const DateTime& end,
                                  const Timezone& tz,
-                                 std::function<void(const std::vector<Appointment>&)> func)
+                                 std::function<void(const std::vector<Appointment>&)> func,
+                                 GCancellable* cancellable)
+{
+    p->stream_appointments(begin, end, tz, [func](const std::vector<Appointment>& appointments, bool done){
+        if (done)
+            func(appointments);
+    }, cancellable);
+}
+
+void EdsEngine::stream_appointments(const DateTime& begin,
+                                    const DateTime& end,
+                                    const Timezone& tz,
+                                    std::function<void(const std::vector<Appointment>&, bool done)> func,
+                                    GCancellable* cancellable)
 {
-    p->get_appointments(begin, end, tz, func);
+    p->stream_appointments(begin, end, tz, func, cancellable);
 }
 
 void EdsEngine::disable_ubuntu_alarm(const Appointment& appointment)
@@ -1229,6 +2087,16 @@ void EdsEngine::disable_ubuntu_alarm(const Appointment& appointment)
     p->disable_ubuntu_alarm(appointment);
 }
 
+void EdsEngine::watch_range(const void* key, const DateTime& begin, const DateTime& end)
+{
+    p->watch_range(key, begin, end);
+}
+
+void EdsEngine::unwatch_range(const void* key)
+{
+    p->unwatch_range(key);
+}
+
 /***
 ****
 ***/
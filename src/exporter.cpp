@@ -25,6 +25,11 @@
 #include <glib/gi18n.h>
 #include <gio/gio.h>
 
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -48,6 +53,8 @@ public:
     {
         if (m_bus != nullptr)
         {
+            stop_watching_subscribers();
+
             for(auto& id : m_exported_menu_ids)
                 g_dbus_connection_unexport_menu_model(m_bus, id);
 
@@ -202,6 +209,249 @@ private:
                 g_clear_error(&error);
             }
         }
+
+        start_watching_subscribers();
+    }
+
+    /***
+    ****  Subscribers
+    ****
+    ****  GMenuExporter doesn't say who's watching its menu, so peek at
+    ****  the org.gtk.Menus Start/End calls that clients make on each
+    ****  menu's path and let the menus with no subscribers sleep.
+    ***/
+
+    static std::string menu_path(const Menu& menu)
+    {
+        return std::string(BUS_DATETIME_PATH) + "/" + menu.name();
+    }
+
+    void start_watching_subscribers()
+    {
+        // the filter runs in GDBus' worker thread and may outlive us,
+        // so it gets its own reference to the queue instead of `this'
+        m_calls = std::make_shared<CallQueue>();
+        m_calls->owner = this;
+        m_filter_id = g_dbus_connection_add_filter(m_bus,
+                                                   on_message_filter,
+                                                   new std::shared_ptr<CallQueue>(m_calls),
+                                                   on_call_queue_destroy);
+        update_subscribed();
+    }
+
+    void stop_watching_subscribers()
+    {
+        if (m_filter_id)
+            g_dbus_connection_remove_filter(m_bus, m_filter_id);
+        for (const auto& it : m_sender_watches)
+            g_dbus_connection_signal_unsubscribe(m_bus, it.second);
+        m_sender_watches.clear();
+
+        // the filter may still be running in GDBus' worker thread
+        if (m_calls)
+        {
+            std::lock_guard<std::mutex> lock(m_calls->mutex);
+            m_calls->alive = false;
+            m_calls->owner = nullptr;
+            m_calls->pending.clear();
+            if (m_calls->idle_tag)
+                g_source_remove(m_calls->idle_tag);
+            m_calls->idle_tag = 0;
+        }
+    }
+
+    // called in GDBus' worker thread
+    static GDBusMessage* on_message_filter(GDBusConnection*,
+                                           GDBusMessage* message,
+                                           gboolean incoming,
+                                           gpointer gqueue)
+    {
+        if (incoming &&
+            (g_dbus_message_get_message_type(message) == G_DBUS_MESSAGE_TYPE_METHOD_CALL) &&
+            !g_strcmp0(g_dbus_message_get_interface(message), "org.gtk.Menus"))
+        {
+            const auto member = g_dbus_message_get_member(message);
+            const int sign = !g_strcmp0(member, "Start") ? 1
+                           : !g_strcmp0(member, "End") ? -1
+                           : 0;
+            auto body = g_dbus_message_get_body(message);
+
+            if (sign && body && g_variant_is_of_type(body, G_VARIANT_TYPE("(au)")))
+            {
+                auto groups = g_variant_get_child_value(body, 0);
+                MenuCall call;
+                call.path = g_dbus_message_get_path(message);
+                call.sender = g_dbus_message_get_sender(message);
+                call.n_groups = sign * int(g_variant_n_children(groups));
+                g_variant_unref(groups);
+
+                push_menu_call(*static_cast<std::shared_ptr<CallQueue>*>(gqueue), std::move(call));
+            }
+        }
+
+        return message;
+    }
+
+    struct MenuCall
+    {
+        std::string path;
+        std::string sender;
+        int n_groups; // > 0 for Start, < 0 for End
+    };
+
+    // Shared between the main thread and the filter.
+    // Once the exporter's gone, 'alive' is false and the
+    // last reference is dropped by whichever side is done last.
+    struct CallQueue
+    {
+        std::mutex mutex; // guards the fields below
+        bool alive = true;
+        Impl* owner = nullptr;
+        std::vector<MenuCall> pending;
+        guint idle_tag = 0;
+    };
+
+    static void on_call_queue_destroy(gpointer gqueue)
+    {
+        delete static_cast<std::shared_ptr<CallQueue>*>(gqueue);
+    }
+
+    static void push_menu_call(const std::shared_ptr<CallQueue>& queue, MenuCall&& call)
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+
+        if (!queue->alive)
+            return;
+
+        queue->pending.push_back(std::move(call));
+
+        // use the same priority GDBus dispatches method calls with, so that
+        // a newly-watched menu has caught up by the time Start is answered
+        if (!queue->idle_tag)
+            queue->idle_tag = g_idle_add_full(G_PRIORITY_DEFAULT,
+                                              on_menu_calls_idle,
+                                              new std::shared_ptr<CallQueue>(queue),
+                                              on_call_queue_destroy);
+    }
+
+    static gboolean on_menu_calls_idle(gpointer gqueue)
+    {
+        auto& queue = *static_cast<std::shared_ptr<CallQueue>*>(gqueue);
+
+        Impl* owner = nullptr;
+        std::vector<MenuCall> calls;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->idle_tag = 0;
+            if (queue->alive)
+            {
+                owner = queue->owner;
+                calls.swap(queue->pending);
+            }
+        }
+
+        // the owner can only go away in this thread, so it's still here
+        if (owner != nullptr)
+            owner->process_menu_calls(calls);
+
+        return G_SOURCE_REMOVE;
+    }
+
+    void process_menu_calls(const std::vector<MenuCall>& calls)
+    {
+        for (const auto& call : calls)
+        {
+            auto& senders = m_subscriptions[call.path];
+            const auto n = senders[call.sender] + call.n_groups;
+            if (n > 0)
+                senders[call.sender] = n;
+            else
+                senders.erase(call.sender);
+        }
+
+        update_sender_watches();
+        update_subscribed();
+    }
+
+    // Only listen for the senders that have menu groups open, so that
+    // other names coming and going on the bus don't wake us up
+    void update_sender_watches()
+    {
+        std::set<std::string> senders;
+        for (const auto& it : m_subscriptions)
+            for (const auto& sit : it.second)
+                senders.insert(sit.first);
+
+        for (auto it=m_sender_watches.begin(); it!=m_sender_watches.end(); )
+        {
+            if (senders.count(it->first))
+            {
+                ++it;
+            }
+            else
+            {
+                g_dbus_connection_signal_unsubscribe(m_bus, it->second);
+                it = m_sender_watches.erase(it);
+            }
+        }
+
+        for (const auto& sender : senders)
+        {
+            if (m_sender_watches.count(sender))
+                continue;
+
+            m_sender_watches[sender] = g_dbus_connection_signal_subscribe(m_bus,
+                                                                          "org.freedesktop.DBus",
+                                                                          "org.freedesktop.DBus",
+                                                                          "NameOwnerChanged",
+                                                                          "/org/freedesktop/DBus",
+                                                                          sender.c_str(), // arg0
+                                                                          G_DBUS_SIGNAL_FLAGS_NONE,
+                                                                          on_name_owner_changed,
+                                                                          this,
+                                                                          nullptr);
+        }
+    }
+
+    static void on_name_owner_changed(GDBusConnection*,
+                                      const gchar* /*sender_name*/,
+                                      const gchar* /*object_path*/,
+                                      const gchar* /*interface_name*/,
+                                      const gchar* /*signal_name*/,
+                                      GVariant* parameters,
+                                      gpointer gthis)
+    {
+        const gchar* name = nullptr;
+        const gchar* old_owner = nullptr;
+        const gchar* new_owner = nullptr;
+        g_variant_get(parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+
+        // a client went away without saying End
+        if (!new_owner || !*new_owner)
+            static_cast<Impl*>(gthis)->forget_sender(name);
+    }
+
+    void forget_sender(const std::string& sender)
+    {
+        for (auto& it : m_subscriptions)
+            it.second.erase(sender);
+
+        update_sender_watches();
+        update_subscribed();
+    }
+
+    void update_subscribed()
+    {
+        for (auto& menu : m_menus)
+        {
+            auto it = m_subscriptions.find(menu_path(*menu));
+            const bool subscribed = (it != m_subscriptions.end()) && !it->second.empty();
+            if (menu->subscribed.get() != subscribed)
+            {
+                g_debug("%s menu is %s", menu->name().c_str(), subscribed ? "watched" : "not watched");
+                menu->subscribed.set(subscribed);
+            }
+        }
     }
 
     /***
@@ -226,6 +476,11 @@ private:
     std::shared_ptr<Actions> m_actions;
     std::vector<std::shared_ptr<Menu>> m_menus;
     DatetimeAlarmProperties* m_alarm_props = nullptr;
+
+    guint m_filter_id = 0;
+    std::map<std::string,guint> m_sender_watches; // sender -> NameOwnerChanged subscription
+    std::map<std::string,std::map<std::string,int>> m_subscriptions; // path -> sender -> groups
+    std::shared_ptr<CallQueue> m_calls;
 };
 
 
@@ -20,6 +20,8 @@
 #include <datetime/formatter.h>
 
 #include <datetime/clock.h>
+#include <datetime/compiled-format.h>
+#include <datetime/timer-service.h>
 #include <datetime/utils.h> // T_()
 
 #include <glib.h>
@@ -42,11 +44,7 @@ namespace
 
 void clear_timer(guint& tag)
 {
-    if (tag)
-    {
-        g_source_remove(tag);
-        tag = 0;
-    }
+    TimerService::get_default().remove(tag);
 }
 
 gint calculate_milliseconds_until_next_second(const DateTime& now)
@@ -122,8 +120,12 @@ public:
         m_owner(owner),
         m_clock(clock)
     {
-        m_owner->header_format.changed().connect([this](const std::string& /*fmt*/){update_header();});
+        m_owner->header_format.changed().connect([this](const std::string& fmt){
+            m_header_format = CompiledFormat(fmt);
+            update_header();
+        });
         m_clock->minute_changed.connect([this](){update_header();});
+        m_header_format = CompiledFormat(m_owner->header_format.get());
         update_header();
 
         restartRelativeTimer();
@@ -137,24 +139,13 @@ public:
 
 private:
 
-    static bool format_shows_seconds(const std::string& fmt)
-    {
-        return (fmt.find("%s") != std::string::npos)
-            || (fmt.find("%S") != std::string::npos)
-            || (fmt.find("%T") != std::string::npos)
-            || (fmt.find("%X") != std::string::npos)
-            || (fmt.find("%c") != std::string::npos);
-    }
-
     void update_header()
     {
         // update the header property
-        const auto fmt = m_owner->header_format.get();
-        const auto str = m_clock->localtime().format(fmt);
-        m_owner->header.set(str);
+        m_owner->header.set(m_header_format.format(m_clock->localtime()));
 
         // if the header needs to show seconds, set a timer.
-        if (format_shows_seconds(fmt))
+        if (m_header_format.shows_seconds())
             start_header_timer();
         else
             clear_timer(m_header_seconds_timer);
@@ -170,17 +161,13 @@ private:
         auto interval_msec = calculate_milliseconds_until_next_second(now);
         interval_msec += 50; // add a small margin to ensure the callback
                              // fires /after/ next is reached
-        m_header_seconds_timer = g_timeout_add_full(G_PRIORITY_HIGH,
-                                                    interval_msec,
-                                                    on_header_timer,
-                                                    this,
-                                                    nullptr);
-    }
-
-    static gboolean on_header_timer(gpointer gself)
-    {
-        static_cast<Formatter::Impl*>(gself)->update_header();
-        return G_SOURCE_REMOVE;
+        static constexpr GTimeSpan tolerance_usec {50 * G_TIME_SPAN_MILLISECOND};
+        m_header_seconds_timer = TimerService::get_default().add(interval_msec * G_TIME_SPAN_MILLISECOND,
+                                                                 tolerance_usec,
+                                                                 [this](){
+            m_header_seconds_timer = 0;
+            update_header();
+        });
     }
 
 private:
@@ -191,19 +178,21 @@ private:
 
         const auto now = m_clock->localtime();
         const auto seconds = calculate_seconds_until_next_fifteen_minutes(now.get());
-        m_relative_timer = g_timeout_add_seconds(seconds, onRelativeTimer, this);
-    }
-
-    static gboolean onRelativeTimer(gpointer gself)
-    {
-        auto self = static_cast<Formatter::Impl*>(gself);
-        self->m_owner->relative_format_changed();
-        self->restartRelativeTimer();
-        return G_SOURCE_REMOVE;
+        // every profile's formatter wants this same moment, so
+        // give them enough slack to share a wakeup
+        static constexpr GTimeSpan tolerance_usec {G_TIME_SPAN_SECOND};
+        m_relative_timer = TimerService::get_default().add(seconds * G_TIME_SPAN_SECOND,
+                                                           tolerance_usec,
+                                                           [this](){
+            m_relative_timer = 0;
+            m_owner->relative_format_changed();
+            restartRelativeTimer();
+        });
     }
 
 private:
     Formatter* const m_owner;
+    CompiledFormat m_header_format; // header_format, parsed
     guint m_header_seconds_timer = 0;
     guint m_relative_timer = 0;
 
@@ -258,6 +247,35 @@ Formatter::relative_format(GDateTime* then_begin, GDateTime* then_end) const
     return ret;
 }
 
+std::string
+Formatter::relative_format(const DateTime& then) const
+{
+    const auto now = p->m_clock->localtime();
+    return get_relative_format_string(now.to_usec(), now.day_number(),
+                                      then.to_usec(), then.day_number(),
+                                      false);
+}
+
+std::string
+Formatter::relative_format(const DateTime& then, const DateTime& then_end) const
+{
+    const auto now = p->m_clock->localtime();
+    const bool full_day = (then_end - then) >= G_TIME_SPAN_DAY;
+    std::string ret = get_relative_format_string(now.to_usec(), now.day_number(),
+                                                 then.to_usec(), then.day_number(),
+                                                 full_day);
+
+    // if it's an appointment in a different timezone (and doesn't run for a full day)
+    // then the time should be followed by its timezone.
+    if (!full_day && (now.utc_offset() != then.utc_offset()))
+    {
+        ret += ' ';
+        ret += then.timezone_abbreviation();
+    }
+
+    return ret;
+}
+
 /***
 ****
 ***/
@@ -20,6 +20,7 @@
 #include <datetime/actions-live.h>
 #include <datetime/alarm-queue-simple.h>
 #include <datetime/clock.h>
+#include <datetime/engine-cache.h>
 #include <datetime/engine-mock.h>
 #include <datetime/engine-eds.h>
 #include <datetime/exporter.h>
@@ -31,10 +32,12 @@
 #include <datetime/planner-range.h>
 #include <datetime/settings-live.h>
 #include <datetime/snap.h>
+#include <datetime/snapshot.h>
 #include <datetime/state.h>
 #include <datetime/timezones-live.h>
 #include <datetime/timezone-timedated.h>
 #include <datetime/wakeup-timer-powerd.h>
+#include <datetime/wakeup-timer-timerfd.h>
 #include <notifications/notifications.h>
 
 #include <glib/gi18n.h> // bindtextdomain()
@@ -59,7 +62,7 @@ namespace
         if (!g_strcmp0("lightdm", g_get_user_name()))
             engine.reset(new MockEngine);
         else
-            engine.reset(new EdsEngine(std::shared_ptr<Myself>(new Myself)));
+            engine.reset(new CacheEngine(std::make_shared<EdsEngine>(std::shared_ptr<Myself>(new Myself))));
 
         return engine;
     }
@@ -111,7 +114,9 @@ namespace
         planner->add(upcoming_planner);
         planner->add(snooze_planner);
 
-        auto wakeup_timer = std::make_shared<PowerdWakeupTimer>(clock);
+        // powerd wakes the device up; the timerfd kicks at the exact time
+        auto hardware_timer = std::make_shared<PowerdWakeupTimer>(clock);
+        auto wakeup_timer = std::make_shared<TimerfdWakeupTimer>(clock, hardware_timer);
         return std::make_shared<SimpleAlarmQueue>(clock, planner, wakeup_timer);
     }
 }
@@ -140,6 +145,14 @@ main(int /*argc*/, char** /*argv*/)
     auto engine = create_engine();
     auto timezone_ = std::make_shared<TimedatedTimezone>(system_bus);
     auto state = create_state(engine, timezone_);
+
+    // show last session's appointments until EDS is ready
+    std::unique_ptr<Snapshot> snapshot;
+    if (g_strcmp0("lightdm", g_get_user_name())) {
+        snapshot.reset(new Snapshot(Snapshot::default_filename()));
+        snapshot->track(state);
+    }
+
     auto actions = std::make_shared<LiveActions>(state);
     MenuFactory factory(actions, state);
 
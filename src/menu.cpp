@@ -21,12 +21,12 @@
 
 #include <datetime/formatter.h>
 #include <datetime/state.h>
+#include <datetime/upcoming-index.h>
 
 #include <glib/gi18n.h>
 #include <gio/gio.h>
 
 #include <algorithm>
-#include <iterator>
 #include <vector>
 
 namespace unity {
@@ -38,6 +38,7 @@ namespace datetime {
 ****/
 
 Menu::Menu (Profile profile_in, const std::string& name_in):
+    subscribed(true),
     m_profile(profile_in),
     m_name(name_in)
 {
@@ -53,6 +54,16 @@ Menu::Profile Menu::profile() const
     return m_profile;
 }
 
+unsigned int Menu::rebuilds_requested() const
+{
+    return m_rebuilds_requested;
+}
+
+unsigned int Menu::rebuilds_executed() const
+{
+    return m_rebuilds_executed;
+}
+
 GMenuModel* Menu::menu_model()
 {
     return G_MENU_MODEL(m_menu);
@@ -64,83 +75,164 @@ GMenuModel* Menu::menu_model()
  * next five calendar events, if any.
  *
  * The list might include multiple occurrences of the same event (bug 1515821).
+ *
+ * If there are more than five, the events shown should be, in order of priority:
+ * 1. any events that start or end (bug 1329048) after the current minute today;
+ * 2. any full-day events that span all of today (bug 1302004);
+ * 3. any events that start or end tomorrow;
+ * 4. any events that start or end the day after tomorrow; and so on.
+ *
+ * However, the display order should be the reverse: full-day events
+ * first (since they start first), part-day events afterward in
+ * chronological order. If multiple events have exactly the same start+end
+ * time, they should be sorted alphabetically.
+ *
+ * The menu keeps an UpcomingIndex so that it doesn't redo this from
+ * scratch every minute; this is the one-shot version.
  */
 std::vector<Appointment>
 Menu::get_display_appointments(const std::vector<Appointment>& appointments_in,
                                const DateTime& now,
                                unsigned int max_items)
 {
-    std::vector<Appointment> appointments;
-    std::copy_if(appointments_in.begin(),
-                 appointments_in.end(),
-                 std::back_inserter(appointments),
-                 [now](const Appointment& a){return a.end >= now;});
+    UpcomingIndex index;
+    index.set(AppointmentList(appointments_in));
+    return index.get_display_appointments(now, max_items);
+}
+
+/****
+*****
+****/
 
-    if (appointments.size() > max_items)
+namespace
+{
+
+bool models_equal(GMenuModel* a, GMenuModel* b);
+
+// true if the two menuitems have the same attributes and links
+bool items_equal(GMenuModel* a, int ai, GMenuModel* b, int bi)
+{
+    const char* name;
+    GVariant* value;
+    int n_a = 0;
+    int n_b = 0;
+    bool equal = true;
+
+    auto attributes = g_menu_model_iterate_item_attributes(a, ai);
+    while (equal && g_menu_attribute_iter_get_next(attributes, &name, &value))
     {
-        const auto next_minute = now.add_full(0,0,0,0,1,-now.seconds());
-        const auto start_of_day = now.start_of_day();
-        const auto end_of_day = now.end_of_day();
-
-        /*
-         * If there are more than five, the events shown should be, in order of priority:
-         * 1. any events that start or end (bug 1329048) after the current minute today;
-         * 2. any full-day events that span all of today (bug 1302004);
-         * 3. any events that start or end tomorrow;
-         * 4. any events that start or end the day after tomorrow; and so on.
-         */
-        auto compare = [next_minute, start_of_day, end_of_day](
-            const Appointment& a,
-            const Appointment& b)
-        {
-            const bool a_later_today = (a.begin >= next_minute) || (a.end <= end_of_day);
-            const bool b_later_today = (b.begin >= next_minute) || (b.end <= end_of_day);
-            if (a_later_today != b_later_today)
-                return a_later_today;
-
-            const bool a_full_day_today = (a.begin <= start_of_day) && (end_of_day <= a.end);
-            const bool b_full_day_today = (b.begin <= start_of_day) && (end_of_day <= b.end);
-            if (a_full_day_today != b_full_day_today)
-                return a_full_day_today;
-
-            const bool a_after_today = (a.begin > end_of_day) || (a.end > end_of_day);
-            const bool b_after_today = (a.begin > end_of_day) || (a.end > end_of_day);
-            if (a_after_today != b_after_today)
-                return a_after_today;
-            if (a.begin != b.begin)
-                return a.begin < b.begin;
-            if (b.end != b.end)
-                return a.end < b.end;
+        auto other = g_menu_model_get_item_attribute_value(b, bi, name, nullptr);
+        equal = (other != nullptr) && g_variant_equal(value, other);
+        g_clear_pointer(&other, g_variant_unref);
+        g_variant_unref(value);
+        ++n_a;
+    }
+    g_object_unref(attributes);
 
-            return false;
-        };
-        std::sort(appointments.begin(), appointments.end(), compare);
-        appointments.resize(max_items);
+    if (equal)
+    {
+        attributes = g_menu_model_iterate_item_attributes(b, bi);
+        while (g_menu_attribute_iter_next(attributes))
+            ++n_b;
+        g_object_unref(attributes);
+        equal = n_a == n_b;
     }
 
-    /*
-     * However, the display order should be the reverse: full-day events
-     * first (since they start first), part-day events afterward in
-     * chronological order. If multiple events have exactly the same start+end
-     * time, they should be sorted alphabetically.
-     */
-    auto compare = [](const Appointment& a, const Appointment& b)
+    if (equal)
     {
-        if (a.begin != b.begin)
-            return a.begin < b.begin;
+        GMenuModel* link;
+        n_a = n_b = 0;
+
+        auto links = g_menu_model_iterate_item_links(a, ai);
+        while (equal && g_menu_link_iter_get_next(links, &name, &link))
+        {
+            auto other = g_menu_model_get_item_link(b, bi, name);
+            equal = (other != nullptr) && models_equal(link, other);
+            g_clear_object(&other);
+            g_object_unref(link);
+            ++n_a;
+        }
+        g_object_unref(links);
+
+        if (equal)
+        {
+            links = g_menu_model_iterate_item_links(b, bi);
+            while (g_menu_link_iter_next(links))
+                ++n_b;
+            g_object_unref(links);
+            equal = n_a == n_b;
+        }
+    }
+
+    return equal;
+}
+
+bool models_equal(GMenuModel* a, GMenuModel* b)
+{
+    if (a == b)
+        return true;
 
-        if (a.end != b.end)
-            return a.end < b.end;
+    const auto n = g_menu_model_get_n_items(a);
+    if (n != g_menu_model_get_n_items(b))
+        return false;
 
-        return a.summary < b.summary;
-    };
-    std::sort(appointments.begin(), appointments.end(), compare);
-    return appointments;
+    for (int i=0; i<n; ++i)
+        if (!items_equal(a, i, b, i))
+            return false;
+
+    return true;
 }
 
-/****
-*****
-****/
+void insert_item_from_model(GMenu* target, int target_pos, GMenuModel* source, int source_pos)
+{
+    auto item = g_menu_item_new_from_model(source, source_pos);
+    g_menu_insert_item(target, target_pos, item);
+    g_object_unref(item);
+}
+
+/**
+ * Makes target's items match source's, only touching the ones that differ.
+ *
+ * Each change to an exported GMenu is sent to every subscriber,
+ * so when one appointment's time format changes we want to send
+ * that one menuitem rather than the whole section.
+ */
+void sync_menu(GMenu* target, GMenuModel* source)
+{
+    auto model = G_MENU_MODEL(target);
+    const int n_old = g_menu_model_get_n_items(model);
+    const int n_new = g_menu_model_get_n_items(source);
+
+    // skip over the unchanged items at the front and back
+    int prefix = 0;
+    while ((prefix < n_old) && (prefix < n_new) && items_equal(model, prefix, source, prefix))
+        ++prefix;
+    int suffix = 0;
+    while ((prefix + suffix < n_old) && (prefix + suffix < n_new)
+           && items_equal(model, n_old-1-suffix, source, n_new-1-suffix))
+        ++suffix;
+
+    // replace the changed items in the middle
+    const int old_end = n_old - suffix;
+    const int new_end = n_new - suffix;
+    int i = prefix;
+    for ( ; (i < old_end) && (i < new_end); ++i)
+    {
+        if (!items_equal(model, i, source, i))
+        {
+            g_menu_remove(target, i);
+            insert_item_from_model(target, i, source, i);
+        }
+    }
+
+    // then remove or add the difference
+    for (int j=old_end; j-- > i; )
+        g_menu_remove(target, j);
+    for ( ; i < new_end; ++i)
+        insert_item_from_model(target, i, source, i);
+}
+
+} // unnamed namespace
 
 #define ALARM_ICON_NAME "alarm-clock"
 #define CALENDAR_ICON_NAME "calendar"
@@ -163,48 +255,59 @@ protected:
         for (int i=0; i<NUM_SECTIONS; i++)
             update_section(Section(i));
 
-        // listen for state changes so we can update the menu accordingly
-        m_formatter->header.changed().connect([this](const std::string&){
-            update_header();
-        });
-        m_formatter->header_format.changed().connect([this](const std::string&){
-            update_section(Locations); // need to update x-canonical-time-format
-        });
-        m_formatter->relative_format_changed.connect([this](){
-            update_section(Appointments); // uses formatter.relative_format()
-            update_section(Locations); // uses formatter.relative_format()
-        });
+        // listen for state changes so we can update the menu accordingly.
+        // the formatter may be shared with other profiles' menus and outlive us,
+        // so scope those connections to this menu.
+        m_formatter_connections.push_back(m_formatter->header.changed().connect([this](const std::string&){
+            queue_header();
+        }));
+        m_formatter_connections.push_back(m_formatter->header_format.changed().connect([this](const std::string&){
+            queue_section(Locations); // need to update x-canonical-time-format
+        }));
+        m_formatter_connections.push_back(m_formatter->relative_format_changed.connect([this](){
+            queue_section(Appointments); // uses formatter.relative_format()
+            queue_section(Locations); // uses formatter.relative_format()
+        }));
         m_state->settings->show_clock.changed().connect([this](bool){
-            update_header(); // update header's label
-            update_section(Locations); // locations' relative time may have changed
+            queue_header(); // update header's label
+            queue_section(Locations); // locations' relative time may have changed
         });
         m_state->settings->show_calendar.changed().connect([this](bool){
-            update_section(Calendar);
+            queue_section(Calendar);
         });
         m_state->settings->show_events.changed().connect([this](bool){
-            update_section(Appointments); // showing events got toggled
+            queue_section(Appointments); // showing events got toggled
         });
         m_state->calendar_upcoming->date().changed().connect([this](const DateTime&){
             update_upcoming(); // our m_upcoming is planner->upcoming() filtered by time
         });
-        m_state->calendar_upcoming->appointments().changed().connect([this](const std::vector<Appointment>&){
-            update_upcoming(); // our m_upcoming is planner->upcoming() filtered by time
+        m_state->calendar_upcoming->deltas().connect([this](const AppointmentDelta& delta){
+            if (delta_is_visible(delta))
+                update_upcoming(); // our m_upcoming is planner->upcoming() filtered by time
         });
         m_state->clock->date_changed.connect([this](){
-            update_section(Calendar); // need to update the Date menuitem
-            update_section(Locations); // locations' relative time may have changed
+            queue_section(Calendar); // need to update the Date menuitem
+            queue_section(Locations); // locations' relative time may have changed
         });
         m_state->clock->minute_changed.connect([this](){
             update_upcoming(); // our m_upcoming is planner->upcoming() filtered by time
         });
         m_state->locations->locations.changed().connect([this](const std::vector<Location>&) {
-            update_section(Locations); // "locations" is the list of Locations we show
+            queue_section(Locations); // "locations" is the list of Locations we show
+        });
+        subscribed.changed().connect([this](bool is_subscribed){
+            if (is_subscribed)
+                catch_up();
         });
     }
 
     virtual ~MenuImpl()
     {
+        if (m_flush_tag != 0)
+            g_source_remove(m_flush_tag);
         g_clear_object(&m_menu);
+        for (auto& section : m_sections)
+            g_clear_object(&section);
         g_clear_pointer(&m_serialized_alarm_icon, g_variant_unref);
         g_clear_pointer(&m_serialized_calendar_icon, g_variant_unref);
     }
@@ -221,6 +324,14 @@ protected:
 
     void update_upcoming()
     {
+        // nobody's looking, so don't bother until someone is
+        if (!subscribed.get())
+        {
+            m_upcoming_stale = true;
+            return;
+        }
+        m_upcoming_stale = false;
+
         // The usual case is to show events germane to the current time.
         // However when the user clicks onto a different calendar date,
         // we pick events starting from the beginning of that clicked day.
@@ -230,22 +341,93 @@ protected:
             ? now.start_of_minute()
             : calendar_day.start_of_day();
 
-        auto upcoming = get_display_appointments(
-            m_state->calendar_upcoming->appointments().get(),
-            begin
-        );
+        m_upcoming_begin = begin;
+        m_upcoming_index.set(m_state->calendar_upcoming->appointments().get());
+        auto upcoming = m_upcoming_index.get_display_appointments(begin, 5);
 
         if (m_upcoming != upcoming)
         {
-            m_upcoming.swap(upcoming);
-            update_header(); // show an 'alarm' icon if there are upcoming alarms
-            update_section(Appointments); // "upcoming" is the list of Appointments we show
+            m_upcoming = AppointmentList(std::move(upcoming));
+            queue_header(); // show an 'alarm' icon if there are upcoming alarms
+            queue_section(Appointments); // "upcoming" is the list of Appointments we show
+        }
+    }
+
+    /**
+     * Several of the signals above often fire together -- eg at midnight
+     * the clock's date and minute both change, and the formatter's relative
+     * format may too -- so rather than rebuilding a section for each one,
+     * mark it dirty and rebuild everything that's dirty once, when idle.
+     */
+    void queue_section(Section section)
+    {
+        ++m_rebuilds_requested;
+        m_section_dirty[section] = true;
+        queue_flush();
+    }
+
+    void queue_header()
+    {
+        ++m_rebuilds_requested;
+        m_header_dirty = true;
+        queue_flush();
+    }
+
+    void queue_flush()
+    {
+        // if nobody's watching, leave the dirty flags for catch_up()
+        if ((m_flush_tag == 0) && subscribed.get())
+            m_flush_tag = g_idle_add(on_flush_idle, this);
+    }
+
+    // someone just started watching, so bring everything stale up to date
+    // now rather than in an idle, so that they don't see the stale version
+    void catch_up()
+    {
+        if (m_upcoming_stale)
+            update_upcoming();
+
+        if (m_flush_tag != 0)
+        {
+            g_source_remove(m_flush_tag);
+            m_flush_tag = 0;
+        }
+
+        flush();
+    }
+
+    static gboolean on_flush_idle(gpointer gself)
+    {
+        auto self = static_cast<MenuImpl*>(gself);
+        self->m_flush_tag = 0;
+        self->flush();
+        return G_SOURCE_REMOVE;
+    }
+
+    void flush()
+    {
+        for (int i=0; i<NUM_SECTIONS; i++)
+        {
+            if (m_section_dirty[i])
+            {
+                m_section_dirty[i] = false;
+                ++m_rebuilds_executed;
+                update_section(Section(i));
+            }
+        }
+
+        if (m_header_dirty)
+        {
+            m_header_dirty = false;
+            ++m_rebuilds_executed;
+            update_header();
         }
     }
 
     std::shared_ptr<const State> m_state;
     std::shared_ptr<Actions> m_actions;
     std::shared_ptr<const Formatter> m_formatter;
+    std::vector<core::ScopedConnection> m_formatter_connections;
     GMenu* m_submenu = nullptr;
 
     GVariant* get_serialized_alarm_icon()
@@ -260,7 +442,22 @@ protected:
         return m_serialized_alarm_icon;
     }
 
-    std::vector<Appointment> m_upcoming;
+    AppointmentList m_upcoming;
+    DateTime m_upcoming_begin; // the earliest time that m_upcoming shows
+    bool m_upcoming_stale = false; // true if update_upcoming() was skipped
+    UpcomingIndex m_upcoming_index; // picks m_upcoming from the planner's list
+
+    // true if the delta could change what update_upcoming() shows
+    bool delta_is_visible(const AppointmentDelta& delta) const
+    {
+        if (!m_upcoming_begin.is_set())
+            return true;
+
+        auto visible = [this](const Appointment& a){return a.end >= m_upcoming_begin;};
+        return std::any_of(delta.added.begin(), delta.added.end(), visible)
+            || std::any_of(delta.changed.begin(), delta.changed.end(), visible)
+            || std::any_of(delta.removed.begin(), delta.removed.end(), visible);
+    }
 
 private:
 
@@ -282,12 +479,12 @@ private:
 
         m_submenu = g_menu_new();
 
-        // build placeholders for the sections
+        // build the sections. update_section() keeps these same
+        // GMenus and changes their items, rather than replacing them
         for(int i=0; i<NUM_SECTIONS; i++)
         {
-            GMenuItem * item = g_menu_item_new(nullptr, nullptr);
-            g_menu_append_item(m_submenu, item);
-            g_object_unref(item);
+            m_sections[i] = g_menu_new();
+            g_menu_append_section(m_submenu, nullptr, G_MENU_MODEL(m_sections[i]));
         }
 
         // add submenu to the header
@@ -381,10 +578,8 @@ private:
 
             added.insert(appt.uid);
 
-            GDateTime* begin = appt.begin();
-            GDateTime* end = appt.end();
-            auto fmt = m_formatter->relative_format(begin, end);
-            auto unix_time = g_date_time_to_unix(begin);
+            auto fmt = m_formatter->relative_format(appt.begin, appt.end);
+            auto unix_time = appt.begin.to_unix();
 
             auto menu_item = g_menu_item_new (appt.summary.c_str(), nullptr);
             g_menu_item_set_attribute (menu_item, "x-canonical-time", "x", unix_time);
@@ -460,7 +655,7 @@ private:
                 const auto& zone = location.zone();
                 const auto& name = location.name();
                 const auto zone_now = now.to_timezone(zone);
-                const auto fmt = m_formatter->relative_format(zone_now.get());
+                const auto fmt = m_formatter->relative_format(zone_now);
                 auto detailed_action = g_strdup_printf("indicator.set-location::%s %s", zone.c_str(), name.c_str());
                 auto i = g_menu_item_new (name.c_str(), detailed_action);
                 g_menu_item_set_attribute(i, "x-canonical-type", "s", "com.canonical.indicator.location");
@@ -509,12 +704,16 @@ private:
 
         if (model)
         {
-            g_menu_remove(m_submenu, section);
-            g_menu_insert_section(m_submenu, section, nullptr, model);
+            sync_menu(m_sections[section], model);
             g_object_unref(model);
         }
     }
 
+    GMenu* m_sections[NUM_SECTIONS] = {};
+    bool m_section_dirty[NUM_SECTIONS] = {};
+    bool m_header_dirty = false;
+    guint m_flush_tag = 0;
+
 //private:
     GVariant * m_serialized_alarm_icon = nullptr;
     GVariant * m_serialized_calendar_icon = nullptr;
@@ -533,9 +732,9 @@ protected:
     DesktopBaseMenu(Menu::Profile profile_,
                     const std::string& name_,
                     std::shared_ptr<const State>& state_,
-                    std::shared_ptr<Actions>& actions_):
-        MenuImpl(profile_, name_, state_, actions_,
-                 std::shared_ptr<const Formatter>(new DesktopFormatter(state_->clock, state_->settings)))
+                    std::shared_ptr<Actions>& actions_,
+                    std::shared_ptr<const Formatter> formatter_):
+        MenuImpl(profile_, name_, state_, actions_, formatter_)
     {
         update_header();
     }
@@ -559,15 +758,19 @@ protected:
 class DesktopMenu: public DesktopBaseMenu
 {
 public:
-    DesktopMenu(std::shared_ptr<const State>& state_, std::shared_ptr<Actions>& actions_):
-        DesktopBaseMenu(Desktop,"desktop", state_, actions_) {}
+    DesktopMenu(std::shared_ptr<const State>& state_,
+                std::shared_ptr<Actions>& actions_,
+                std::shared_ptr<const Formatter> formatter_):
+        DesktopBaseMenu(Desktop,"desktop", state_, actions_, formatter_) {}
 };
 
 class DesktopGreeterMenu: public DesktopBaseMenu
 {
 public:
-    DesktopGreeterMenu(std::shared_ptr<const State>& state_, std::shared_ptr<Actions>& actions_):
-        DesktopBaseMenu(DesktopGreeter,"desktop_greeter", state_, actions_) {}
+    DesktopGreeterMenu(std::shared_ptr<const State>& state_,
+                       std::shared_ptr<Actions>& actions_,
+                       std::shared_ptr<const Formatter> formatter_):
+        DesktopBaseMenu(DesktopGreeter,"desktop_greeter", state_, actions_, formatter_) {}
 };
 
 class PhoneBaseMenu: public MenuImpl
@@ -576,9 +779,9 @@ protected:
     PhoneBaseMenu(Menu::Profile profile_,
                   const std::string& name_,
                   std::shared_ptr<const State>& state_,
-                  std::shared_ptr<Actions>& actions_):
-        MenuImpl(profile_, name_, state_, actions_,
-                 std::shared_ptr<Formatter>(new PhoneFormatter(state_->clock)))
+                  std::shared_ptr<Actions>& actions_,
+                  std::shared_ptr<const Formatter> formatter_):
+        MenuImpl(profile_, name_, state_, actions_, formatter_)
     {
         update_header();
     }
@@ -617,16 +820,18 @@ class PhoneMenu: public PhoneBaseMenu
 {
 public:
     PhoneMenu(std::shared_ptr<const State>& state_,
-              std::shared_ptr<Actions>& actions_):
-        PhoneBaseMenu(Phone, "phone", state_, actions_) {}
+              std::shared_ptr<Actions>& actions_,
+              std::shared_ptr<const Formatter> formatter_):
+        PhoneBaseMenu(Phone, "phone", state_, actions_, formatter_) {}
 };
 
 class PhoneGreeterMenu: public PhoneBaseMenu
 {
 public:
     PhoneGreeterMenu(std::shared_ptr<const State>& state_,
-                     std::shared_ptr<Actions>& actions_):
-        PhoneBaseMenu(PhoneGreeter, "phone_greeter", state_, actions_) {}
+                     std::shared_ptr<Actions>& actions_,
+                     std::shared_ptr<const Formatter> formatter_):
+        PhoneBaseMenu(PhoneGreeter, "phone_greeter", state_, actions_, formatter_) {}
 };
 
 /****
@@ -648,19 +853,19 @@ MenuFactory::buildMenu(Menu::Profile profile)
     switch (profile)
     {
     case Menu::Desktop:
-        menu.reset(new DesktopMenu(m_state, m_actions));
+        menu.reset(new DesktopMenu(m_state, m_actions, desktop_formatter()));
         break;
 
     case Menu::DesktopGreeter:
-        menu.reset(new DesktopGreeterMenu(m_state, m_actions));
+        menu.reset(new DesktopGreeterMenu(m_state, m_actions, desktop_formatter()));
         break;
 
     case Menu::Phone:
-        menu.reset(new PhoneMenu(m_state, m_actions));
+        menu.reset(new PhoneMenu(m_state, m_actions, phone_formatter()));
         break;
 
     case Menu::PhoneGreeter:
-        menu.reset(new PhoneGreeterMenu(m_state, m_actions));
+        menu.reset(new PhoneGreeterMenu(m_state, m_actions, phone_formatter()));
         break;
 
     default:
@@ -671,6 +876,27 @@ MenuFactory::buildMenu(Menu::Profile profile)
     return menu;
 }
 
+// profiles with the same format settings share a Formatter,
+// so the header is only formatted once per tick for all of them
+
+std::shared_ptr<const Formatter>
+MenuFactory::desktop_formatter()
+{
+    if (!m_desktop_formatter)
+        m_desktop_formatter.reset(new DesktopFormatter(m_state->clock, m_state->settings));
+
+    return m_desktop_formatter;
+}
+
+std::shared_ptr<const Formatter>
+MenuFactory::phone_formatter()
+{
+    if (!m_phone_formatter)
+        m_phone_formatter.reset(new PhoneFormatter(m_state->clock));
+
+    return m_phone_formatter;
+}
+
 /****
 *****
 ****/
@@ -19,6 +19,9 @@
 
 #include <datetime/planner-aggregate.h>
 
+#include <algorithm> // std::is_sorted()
+#include <queue>
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -37,16 +40,17 @@ public:
 
     ~Impl() =default;
 
-    core::Property<std::vector<Appointment>>& appointments()
+    core::Property<AppointmentList>& appointments()
     {
         return m_appointments;
     }
 
     void add(const std::shared_ptr<Planner>& planner)
     {
+        const auto index = m_planners.size();
         m_planners.push_back(planner);
 
-        auto on_changed = [this](const std::vector<Appointment>&){rebuild();};
+        auto on_changed = [this, index](const AppointmentList&){replace(index);};
         auto connection = planner->appointments().changed().connect(on_changed);
         m_connections.push_back(connection);
     }
@@ -55,20 +59,136 @@ private:
 
     void rebuild()
     {
-      // use a sorted aggregate vector of all our planners
-      std::vector<Appointment> all;
-      for (const auto& planner : m_planners) {
-          const auto& walk = planner->appointments().get();
-          all.insert(std::end(all), std::begin(walk), std::end(walk));
+      std::vector<const AppointmentList*> lists;
+      std::vector<size_t> indices;
+      for (size_t i=0, n=m_planners.size(); i<n; ++i) {
+          const auto& walk = m_planners[i]->appointments().get();
+          if (!walk.empty()) {
+              lists.push_back(&walk);
+              indices.push_back(i);
+          }
+      }
+
+      // if only one of our planners has appointments, share its list
+      if (lists.size() < 2) {
+          if (lists.empty()) {
+              m_origins.clear();
+              m_appointments.set(AppointmentList());
+          } else {
+              m_origins.assign(lists.front()->size(), indices.front());
+              m_appointments.set(*lists.front());
+          }
+          return;
       }
-      m_owner->sort(all);
-      m_appointments.set(all);
+
+      // otherwise merge our planners' sorted lists
+      m_appointments.set(AppointmentList(merge(lists, indices, m_origins)));
+    }
+
+    // one planner changed, so swap its slice of our list
+    // for its new list without disturbing the others
+    void replace(size_t index)
+    {
+        const auto& old = m_appointments.get();
+        if (m_origins.size() != old.size())
+            return rebuild();
+
+        const auto& fresh = m_planners[index]->appointments().get();
+        if (!std::is_sorted(fresh.begin(), fresh.end(), earlier))
+            return rebuild();
+
+        std::vector<Appointment> merged;
+        std::vector<size_t> origins;
+        merged.reserve(old.size() + fresh.size());
+        origins.reserve(old.size() + fresh.size());
+
+        bool shared = true; // true if `fresh' is all that's left
+        auto f = fresh.begin();
+        for (size_t i=0, n=old.size(); i<n; ++i) {
+            if (m_origins[i] == index)
+                continue;
+            shared = false;
+            for (; f!=fresh.end() && earlier(*f, old[i]); ++f) {
+                merged.push_back(*f);
+                origins.push_back(index);
+            }
+            merged.push_back(old[i]);
+            origins.push_back(m_origins[i]);
+        }
+
+        if (shared) {
+            m_origins.assign(fresh.size(), index);
+            m_appointments.set(fresh);
+            return;
+        }
+
+        for (; f!=fresh.end(); ++f) {
+            merged.push_back(*f);
+            origins.push_back(index);
+        }
+        m_origins.swap(origins);
+        m_appointments.set(AppointmentList(std::move(merged)));
+    }
+
+    static bool earlier(const Appointment& a, const Appointment& b)
+    {
+        return a.begin < b.begin;
+    }
+
+    // k-way merge of the planners' lists, which are already sorted
+    std::vector<Appointment> merge(const std::vector<const AppointmentList*>& lists,
+                                   const std::vector<size_t>& indices,
+                                   std::vector<size_t>& origins) const
+    {
+        struct Cursor {
+            AppointmentList::const_iterator it;
+            AppointmentList::const_iterator end;
+            size_t index;
+        };
+        auto later = [](const Cursor& a, const Cursor& b){
+            return earlier(*b.it, *a.it) || (!earlier(*a.it, *b.it) && (a.index > b.index));
+        };
+        std::priority_queue<Cursor,std::vector<Cursor>,decltype(later)> heap(later);
+
+        std::vector<AppointmentList> sorted; // just in case a planner didn't sort
+        sorted.reserve(lists.size());
+        for (const auto& walk : lists) {
+            const auto& list = *walk;
+            if (std::is_sorted(list.begin(), list.end(), earlier)) {
+                sorted.push_back(list);
+            } else {
+                std::vector<Appointment> tmp = list;
+                m_owner->sort(tmp);
+                sorted.push_back(AppointmentList(std::move(tmp)));
+            }
+        }
+
+        size_t n = 0;
+        for (size_t i=0, m=sorted.size(); i<m; ++i) {
+            n += sorted[i].size();
+            heap.push(Cursor{sorted[i].begin(), sorted[i].end(), indices[i]});
+        }
+
+        std::vector<Appointment> merged;
+        merged.reserve(n);
+        origins.clear();
+        origins.reserve(n);
+        while (!heap.empty()) {
+            auto cursor = heap.top();
+            heap.pop();
+            merged.push_back(*cursor.it);
+            origins.push_back(cursor.index);
+            if (++cursor.it != cursor.end)
+                heap.push(cursor);
+        }
+        return merged;
     }
 
     const AggregatePlanner* m_owner = nullptr;
-    core::Property<std::vector<Appointment>> m_appointments;
+    core::Property<AppointmentList> m_appointments;
     std::vector<std::shared_ptr<Planner>> m_planners;
     std::vector<core::ScopedConnection> m_connections;
+    std::vector<size_t> m_origins; // which planner each of our appointments came from
 };
 
 /***
@@ -84,7 +204,7 @@ AggregatePlanner::~AggregatePlanner()
 {
 }
 
-core::Property<std::vector<Appointment>>&
+core::Property<AppointmentList>&
 AggregatePlanner::appointments()
 {
     return impl->appointments();
@@ -19,6 +19,8 @@
 
 #include <datetime/planner-month.h>
 
+#include <algorithm>
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -31,14 +33,40 @@ MonthPlanner::MonthPlanner(const std::shared_ptr<RangePlanner>& range_planner,
                            const DateTime& month_in):
     m_range_planner(range_planner)
 {
+    m_day_counts.fill(0);
+
     month().changed().connect([this](const DateTime& m){
         auto month_begin = m.start_of_month();
         auto month_end = m.end_of_month();
+
+        // the appointments we already know about may cover the new month too
+        m_month_first_day = month_begin.day_number();
+        m_month_last_day = month_end.day_number();
+        recount();
+        update_appointment_days();
+
         g_debug("PlannerMonth %p setting calendar month range: [%s..%s]", this, month_begin.format("%F %T").c_str(), month_end.format("%F %T").c_str());
         m_range_planner->range().set(std::pair<DateTime,DateTime>(month_begin,month_end));
     });
 
     month().set(month_in);
+
+    // index what's already there, then keep the index current from the deltas
+    for (const auto& appt : appointments().get())
+        add(appt);
+    update_appointment_days();
+
+    deltas().connect([this](const AppointmentDelta& delta){
+        for (const auto& appt : delta.removed)
+            remove(appt, true);
+        for (const auto& appt : delta.changed) {
+            remove(appt, false); // we only get the new version
+            add(appt);
+        }
+        for (const auto& appt : delta.added)
+            add(appt);
+        update_appointment_days();
+    });
 }
 
 core::Property<DateTime>& MonthPlanner::month()
@@ -46,11 +74,93 @@ core::Property<DateTime>& MonthPlanner::month()
     return m_month;
 }
 
-core::Property<std::vector<Appointment>>& MonthPlanner::appointments()
+core::Property<AppointmentList>& MonthPlanner::appointments()
 {
     return m_range_planner->appointments();
 }
 
+core::Property<std::vector<int>>& MonthPlanner::appointment_days()
+{
+    return m_appointment_days;
+}
+
+/***
+****
+***/
+
+MonthPlanner::Days MonthPlanner::days_of(const Appointment& appt)
+{
+    Days days;
+    days.first = days.last = appt.begin.day_number();
+
+    // the end is exclusive, so an event that ends at midnight
+    // doesn't cover the day after it
+    if (appt.end.is_set() && (appt.end > appt.begin))
+    {
+        const int64_t t = appt.end.to_usec() - 1 + appt.end.utc_offset();
+        const int64_t last = (t / G_TIME_SPAN_DAY) - ((t % G_TIME_SPAN_DAY) < 0 ? 1 : 0);
+        days.last = std::max(days.first, last);
+    }
+
+    return days;
+}
+
+void MonthPlanner::add(const Appointment& appt)
+{
+    const auto days = days_of(appt);
+    m_days[InstanceKey(appt.uid, appt.begin.to_unix())].push_back(days);
+    count(days, 1);
+}
+
+void MonthPlanner::remove(const Appointment& appt, bool match_days)
+{
+    auto it = m_days.find(InstanceKey(appt.uid, appt.begin.to_unix()));
+    if (it == m_days.end())
+        return;
+
+    auto& instances = it->second;
+    auto days = instances.begin();
+    if (match_days)
+    {
+        const auto want = days_of(appt);
+        days = std::find_if(instances.begin(), instances.end(), [&want](const Days& d){
+            return (d.first == want.first) && (d.last == want.last);
+        });
+        if (days == instances.end())
+            days = instances.begin();
+    }
+
+    count(*days, -1);
+    instances.erase(days);
+    if (instances.empty())
+        m_days.erase(it);
+}
+
+void MonthPlanner::count(const Days& days, int n)
+{
+    const auto first = std::max(days.first, m_month_first_day);
+    const auto last = std::min(days.last, m_month_last_day);
+    for (auto day=first; day<=last; ++day)
+        m_day_counts[1 + day - m_month_first_day] += n;
+}
+
+void MonthPlanner::recount()
+{
+    m_day_counts.fill(0);
+    for (const auto& it : m_days)
+        for (const auto& days : it.second)
+            count(days, 1);
+}
+
+void MonthPlanner::update_appointment_days()
+{
+    std::vector<int> days;
+    for (size_t i=1; i<m_day_counts.size(); ++i)
+        if (m_day_counts[i] > 0)
+            days.push_back(int(i));
+    m_appointment_days.set(days);
+}
+
 
 /***
 ****
@@ -18,6 +18,10 @@
  */
 
 #include <datetime/planner-range.h>
+#include <datetime/timer-service.h>
+
+#include <algorithm> // std::sort()
+#include <set>
 
 namespace unity {
 namespace indicator {
@@ -51,47 +55,108 @@ SimpleRangePlanner::SimpleRangePlanner(const std::shared_ptr<Engine>& engine,
 
 SimpleRangePlanner::~SimpleRangePlanner()
 {
-    if (m_rebuild_tag)
-        g_source_remove(m_rebuild_tag);
+    cancel_request();
+    m_engine->unwatch_range(this);
+
+    TimerService::get_default().remove(m_rebuild_tag);
 }
 
 /***
 ****
 ***/
 
+void SimpleRangePlanner::cancel_request()
+{
+    if (m_cancellable != nullptr)
+    {
+        g_cancellable_cancel(m_cancellable);
+        g_clear_object(&m_cancellable);
+    }
+}
+
 void SimpleRangePlanner::rebuild_now()
 {
     const auto& r = range().get();
-
-    auto on_appointments_fetched = [this](const std::vector<Appointment>& a){
-        g_debug("RangePlanner %p got %zu appointments", this, a.size());
-        appointments().set(a);
+    m_engine->watch_range(this, r.first, r.second);
+
+    // if the previous request is still in flight, its range is stale
+    cancel_request();
+    m_cancellable = g_cancellable_new();
+    const auto generation = ++m_generation;
+
+    // show the first source's results right away so a slow source doesn't
+    // hold up the rest, but publish the partial merge only once: every
+    // set() reaches the alarm queue, the menus, and the snapshot
+    const auto previous = appointments().get();
+    auto received = std::make_shared<std::vector<Appointment>>();
+    auto published = std::make_shared<bool>(false);
+    auto on_appointments_fetched = [this, generation, r, previous, received, published](const std::vector<Appointment>& a, bool done){
+        if (generation != m_generation) {
+            g_debug("RangePlanner %p discarding %zu appointments from superseded request", this, a.size());
+            return;
+        }
+        if (done) {
+            g_debug("RangePlanner %p got %zu appointments", this, a.size());
+            appointments().set(a);
+        } else {
+            g_debug("RangePlanner %p got a batch of %zu appointments", this, a.size());
+            received->insert(received->end(), a.begin(), a.end());
+            if (!*published && !a.empty()) {
+                *published = true;
+                appointments().set(merge_partial(*received, previous, r));
+            }
+        }
     };
 
-    m_engine->get_appointments(r.first, r.second, *m_timezone.get(), on_appointments_fetched);
+    m_engine->stream_appointments(r.first, r.second, *m_timezone.get(), on_appointments_fetched, m_cancellable);
 }
 
-void SimpleRangePlanner::rebuild_soon()
+/**
+ * Until the last source reports in, keep showing the previous appointments
+ * from the sources that haven't been heard from yet. A source that has
+ * reported in replaces all of its previous appointments.
+ */
+std::vector<Appointment>
+SimpleRangePlanner::merge_partial(const std::vector<Appointment>& received,
+                                  const std::vector<Appointment>& previous,
+                                  const std::pair<DateTime,DateTime>& range)
 {
-    static const int ARBITRARY_BATCH_MSEC = 200;
-
-    if (m_rebuild_tag == 0)
-        m_rebuild_tag = g_timeout_add(ARBITRARY_BATCH_MSEC, rebuild_now_static, this);
+    std::set<std::string> sources;
+    std::set<std::pair<std::string,int64_t>> instances;
+    for (const auto& appointment : received) {
+        sources.insert(appointment.source_uid);
+        instances.insert(std::make_pair(appointment.uid, appointment.begin.to_unix()));
+    }
+
+    auto merged = received;
+    for (const auto& appointment : previous)
+        if (!sources.count(appointment.source_uid)
+            && !instances.count(std::make_pair(appointment.uid, appointment.begin.to_unix()))
+            && !(appointment.end < range.first)
+            && !(range.second < appointment.begin))
+            merged.push_back(appointment);
+
+    std::sort(merged.begin(), merged.end(), [](const Appointment& a, const Appointment& b){return a.begin < b.begin;});
+    return merged;
 }
 
-gboolean SimpleRangePlanner::rebuild_now_static(gpointer gself)
+void SimpleRangePlanner::rebuild_soon()
 {
-    auto self = static_cast<SimpleRangePlanner*>(gself);
-    self->m_rebuild_tag = 0;
-    self->rebuild_now();
-    return G_SOURCE_REMOVE;
+    static constexpr GTimeSpan ARBITRARY_BATCH_USEC {200 * G_TIME_SPAN_MILLISECOND};
+    static constexpr GTimeSpan TOLERANCE_USEC {100 * G_TIME_SPAN_MILLISECOND};
+
+    if (m_rebuild_tag == 0)
+        m_rebuild_tag = TimerService::get_default().add(ARBITRARY_BATCH_USEC, TOLERANCE_USEC, [this](){
+            m_rebuild_tag = 0;
+            rebuild_now();
+        });
 }
 
 /***
 ****
 ***/
 
-core::Property<std::vector<Appointment>>& SimpleRangePlanner::appointments()
+core::Property<AppointmentList>& SimpleRangePlanner::appointments()
 {
     return m_appointments;
 }
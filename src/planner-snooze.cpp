@@ -21,6 +21,8 @@
 
 #include <libedataserver/libedataserver.h> // e_uid_new()
 
+#include <algorithm> // std::upper_bound()
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -46,7 +48,7 @@ public:
     {
     }
 
-    core::Property<std::vector<Appointment>>& appointments()
+    core::Property<AppointmentList>& appointments()
     {
         return m_appointments;
     }
@@ -69,11 +71,17 @@ public:
         appt.uid = uid;
         g_free(uid);
 
-        // add it to our appointment list
-        auto tmp = appointments().get();
+        // add it to our appointment list, which is already sorted
+        const auto& old = appointments().get();
+        const auto pos = std::upper_bound(old.begin(), old.end(), appt, [](const Appointment& a, const Appointment& b){
+            return a.begin < b.begin;
+        });
+        std::vector<Appointment> tmp;
+        tmp.reserve(old.size() + 1);
+        tmp.insert(tmp.end(), old.begin(), pos);
         tmp.push_back(appt);
-        m_owner->sort(tmp);
-        m_appointments.set(tmp);
+        tmp.insert(tmp.end(), pos, old.end());
+        m_appointments.set(AppointmentList(std::move(tmp)));
     }
 
 private:
@@ -81,7 +89,7 @@ private:
     const SnoozePlanner* const m_owner;
     const std::shared_ptr<Settings> m_settings;
     const std::shared_ptr<Clock> m_clock;
-    core::Property<std::vector<Appointment>> m_appointments;
+    core::Property<AppointmentList> m_appointments;
 };
 
 /***
@@ -104,7 +112,7 @@ SnoozePlanner::add(const Appointment& appointment, const Alarm& alarm)
     impl->add(appointment, alarm);
 }
 
-core::Property<std::vector<Appointment>>&
+core::Property<AppointmentList>&
 SnoozePlanner::appointments()
 {
     return impl->appointments();
@@ -47,7 +47,7 @@ core::Property<DateTime>& UpcomingPlanner::date()
     return m_date;
 }
 
-core::Property<std::vector<Appointment>>& UpcomingPlanner::appointments()
+core::Property<AppointmentList>& UpcomingPlanner::appointments()
 {
     return m_range_planner->appointments();
 }
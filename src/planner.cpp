@@ -45,6 +45,100 @@ Planner::sort(std::vector<Appointment>& appts)
               [](const Appointment& a, const Appointment& b){return a.begin < b.begin;});
 }
 
+bool
+Planner::find_appointment(const std::string& uid, Appointment& setme)
+{
+    if (!m_uid_index_connection)
+        m_uid_index_connection.reset(new core::ScopedConnection(appointments().changed().connect([this](const std::vector<Appointment>&){
+            m_uid_index_dirty = true;
+        })));
+
+    const auto& appts = appointments().get();
+
+    if (m_uid_index_dirty)
+    {
+        m_uid_index.clear();
+        m_uid_index.reserve(appts.size());
+        for (size_t i=0, n=appts.size(); i<n; ++i)
+            m_uid_index.insert(std::make_pair(appts[i].uid, i)); // keeps the first instance
+        m_uid_index_dirty = false;
+    }
+
+    auto it = m_uid_index.find(uid);
+    if (it == m_uid_index.end())
+        return false;
+
+    setme = appts[it->second];
+    return true;
+}
+
+core::Signal<const AppointmentDelta&>&
+Planner::deltas()
+{
+    if (!m_deltas_connection)
+    {
+        m_previous = appointments().get();
+        m_deltas_connection.reset(new core::ScopedConnection(appointments().changed().connect([this](const AppointmentList& appts){
+            const auto delta = diff(m_previous, appts);
+            m_previous = appts;
+            if (!delta.empty())
+                m_deltas(delta);
+        })));
+    }
+
+    return m_deltas;
+}
+
+namespace
+{
+    typedef std::pair<std::string,int64_t> InstanceKey;
+
+    struct InstanceKeyHash
+    {
+        size_t operator()(const InstanceKey& key) const
+        {
+            return std::hash<std::string>()(key.first) ^ (std::hash<int64_t>()(key.second) << 1);
+        }
+    };
+
+    InstanceKey instance_key(const Appointment& appt)
+    {
+        return InstanceKey{appt.uid, appt.begin.to_unix()};
+    }
+} // unnamed namespace
+
+AppointmentDelta
+Planner::diff(const std::vector<Appointment>& before,
+              const std::vector<Appointment>& after)
+{
+    AppointmentDelta delta;
+
+    std::unordered_map<InstanceKey,const Appointment*,InstanceKeyHash> old;
+    old.reserve(before.size());
+    for (const auto& appt : before)
+        old[instance_key(appt)] = &appt;
+
+    for (const auto& appt : after)
+    {
+        auto it = old.find(instance_key(appt));
+        if (it == old.end())
+            delta.added.push_back(appt);
+        else
+        {
+            if (!(*it->second == appt))
+                delta.changed.push_back(appt);
+            old.erase(it);
+        }
+    }
+
+    // whatever's left wasn't in the new list
+    for (const auto& appt : before)
+        if (old.count(instance_key(appt)))
+            delta.removed.push_back(appt);
+
+    return delta;
+}
+
 /***
 ****
 ***/
@@ -0,0 +1,388 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/snapshot.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <fcntl.h> // open()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h> // close()
+
+#include <cstdint>
+#include <cstring> // memcmp(), memcpy()
+#include <map>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****  File format
+****
+****  A Header, then n_upcoming + n_month Records, then a pool of
+****  NUL-terminated strings that the Records refer to by offset.
+****  Everything is in host byte order; it's a cache, not an export.
+***/
+
+namespace
+{
+    constexpr char MAGIC[8] = {'I','D','T','S','N','A','P','\0'};
+    constexpr uint32_t VERSION = 2;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t n_upcoming;
+        uint32_t n_month;
+        uint32_t strings_size;
+        int64_t month_begin;
+    };
+
+    enum { UID, SOURCE_UID, COLOR, SUMMARY, ACTIVATION_URL, N_STRINGS };
+
+    struct Record
+    {
+        int64_t begin;
+        int64_t end;
+        int32_t begin_offset; // utc offset, in seconds
+        int32_t end_offset;
+        uint32_t type;
+        uint32_t strings[N_STRINGS]; // offsets into the string pool
+    };
+
+    class StringPool
+    {
+    public:
+        StringPool(): m_pool(1, '\0') {} // offset 0 is the empty string
+
+        uint32_t add(const std::string& str)
+        {
+            if (str.empty())
+                return 0;
+
+            auto it = m_offsets.find(str);
+            if (it != m_offsets.end())
+                return it->second;
+
+            const auto offset = uint32_t(m_pool.size());
+            m_pool.append(str.c_str(), str.size()+1);
+            m_offsets[str] = offset;
+            return offset;
+        }
+
+        const std::string& str() const {return m_pool;}
+
+    private:
+        std::string m_pool;
+        std::map<std::string,uint32_t> m_offsets;
+    };
+
+    // GTimeZone can't tell us its tzid until glib 2.58, so only the offset
+    // is saved. Times in the local zone get the local zone back; the rest
+    // get a fixed-offset zone that shows the same wall-clock time.
+    DateTime restore_time(int64_t t, int32_t offset)
+    {
+        auto dt = DateTime::Local(t);
+        if (dt.utc_offset() == offset * G_USEC_PER_SEC)
+            return dt;
+
+        const int32_t abs_offset = offset < 0 ? -offset : offset;
+        char identifier[16];
+        g_snprintf(identifier, sizeof(identifier), "%c%02d:%02d",
+                   offset < 0 ? '-' : '+',
+                   int(abs_offset / 3600), int((abs_offset / 60) % 60));
+        auto gtz = g_time_zone_new(identifier);
+        dt = DateTime(gtz, time_t(t));
+        g_time_zone_unref(gtz);
+        return dt;
+    }
+
+    Record to_record(const Appointment& appt, StringPool& pool, bool with_strings)
+    {
+        Record r {};
+        r.begin = appt.begin.to_unix();
+        r.end = appt.end.to_unix();
+        r.begin_offset = int32_t(appt.begin.utc_offset() / G_USEC_PER_SEC);
+        r.end_offset = int32_t(appt.end.utc_offset() / G_USEC_PER_SEC);
+        r.type = uint32_t(appt.type);
+        if (with_strings)
+        {
+            r.strings[UID] = pool.add(appt.uid);
+            r.strings[SOURCE_UID] = pool.add(appt.source_uid);
+            r.strings[COLOR] = pool.add(appt.color);
+            r.strings[SUMMARY] = pool.add(appt.summary);
+            r.strings[ACTIVATION_URL] = pool.add(appt.activation_url);
+        }
+        return r;
+    }
+
+    Appointment from_record(const Record& r, const char* strings)
+    {
+        Appointment appt;
+        appt.type = r.type == uint32_t(Appointment::UBUNTU_ALARM) ? Appointment::UBUNTU_ALARM : Appointment::EVENT;
+        appt.uid = strings + r.strings[UID];
+        appt.source_uid = strings + r.strings[SOURCE_UID];
+        appt.color = strings + r.strings[COLOR];
+        appt.summary = strings + r.strings[SUMMARY];
+        appt.activation_url = strings + r.strings[ACTIVATION_URL];
+        appt.begin = restore_time(r.begin, r.begin_offset);
+        appt.end = restore_time(r.end, r.end_offset);
+        return appt;
+    }
+}
+
+/***
+****
+***/
+
+class Snapshot::Impl
+{
+public:
+
+    Impl(const std::string& filename):
+        m_filename(filename)
+    {
+    }
+
+    ~Impl()
+    {
+        if (m_save_tag)
+            g_source_remove(m_save_tag);
+    }
+
+    void track(const std::shared_ptr<State>& state)
+    {
+        m_state = state;
+
+        // seed the planners...
+        const auto before = g_get_monotonic_time();
+        std::vector<Appointment> upcoming, month;
+        if (load(state->clock->localtime(), upcoming, month))
+        {
+            if (!month.empty())
+                state->calendar_month->appointments().set(month);
+            if (!upcoming.empty())
+                state->calendar_upcoming->appointments().set(upcoming);
+        }
+        g_debug("%s populated %zu upcoming and %zu month appointments in %.3f msec",
+                m_filename.c_str(), upcoming.size(), month.size(),
+                (g_get_monotonic_time() - before) / 1000.0);
+
+        // ...and keep the snapshot current
+        auto on_changed = [this](const std::vector<Appointment>&){save_soon();};
+        m_connections.push_back(state->calendar_month->appointments().changed().connect(on_changed));
+        m_connections.push_back(state->calendar_upcoming->appointments().changed().connect(on_changed));
+    }
+
+    bool load(const DateTime& now,
+              std::vector<Appointment>& upcoming,
+              std::vector<Appointment>& month) const
+    {
+        const int fd = open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            return false;
+
+        bool ok = false;
+        struct stat st;
+        if (!fstat(fd, &st) && (size_t(st.st_size) >= sizeof(Header)))
+        {
+            const size_t size = st.st_size;
+            auto map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                ok = parse(static_cast<const char*>(map), size, now, upcoming, month);
+                munmap(map, size);
+            }
+        }
+        close(fd);
+
+        if (!ok)
+            g_debug("ignoring missing or invalid snapshot '%s'", m_filename.c_str());
+
+        return ok;
+    }
+
+    void save(const DateTime& month_begin,
+              const std::vector<Appointment>& upcoming,
+              const std::vector<Appointment>& month) const
+    {
+        StringPool pool;
+        std::vector<Record> records;
+        records.reserve(upcoming.size() + month.size());
+        for (const auto& appt : upcoming)
+            records.push_back(to_record(appt, pool, true));
+        for (const auto& appt : month) // the calendar only needs the dates
+            records.push_back(to_record(appt, pool, false));
+
+        Header header {};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.n_upcoming = upcoming.size();
+        header.n_month = month.size();
+        header.strings_size = pool.str().size();
+        header.month_begin = month_begin.to_unix();
+
+        std::string buf;
+        buf.reserve(sizeof(Header) + sizeof(Record)*records.size() + pool.str().size());
+        buf.append(reinterpret_cast<const char*>(&header), sizeof(Header));
+        if (!records.empty())
+            buf.append(reinterpret_cast<const char*>(records.data()), sizeof(Record)*records.size());
+        buf += pool.str();
+
+        auto dir = g_path_get_dirname(m_filename.c_str());
+        g_mkdir_with_parents(dir, 0700);
+        g_free(dir);
+
+        GError* error {};
+        if (!g_file_set_contents(m_filename.c_str(), buf.data(), buf.size(), &error))
+        {
+            g_warning("Unable to save appointment snapshot '%s': %s", m_filename.c_str(), error->message);
+            g_error_free(error);
+        }
+    }
+
+private:
+
+    static bool parse(const char* data,
+                      size_t size,
+                      const DateTime& now,
+                      std::vector<Appointment>& upcoming,
+                      std::vector<Appointment>& month)
+    {
+        Header header;
+        memcpy(&header, data, sizeof(Header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) || (header.version != VERSION))
+            return false;
+
+        const uint64_t n_records = uint64_t(header.n_upcoming) + header.n_month;
+        const uint64_t strings_offset = sizeof(Header) + n_records*sizeof(Record);
+        if ((header.strings_size == 0) || (strings_offset + header.strings_size != size))
+            return false;
+
+        const char* strings = data + strings_offset;
+        if (strings[header.strings_size-1] != '\0')
+            return false;
+
+        auto records = reinterpret_cast<const Record*>(data + sizeof(Header));
+        for (uint64_t i=0; i<n_records; ++i)
+            for (const auto offset : records[i].strings)
+                if (offset >= header.strings_size)
+                    return false;
+
+        // skip what's already over
+        const auto today = now.start_of_day().to_unix();
+        for (uint32_t i=0; i<header.n_upcoming; ++i)
+            if (records[i].end >= today)
+                upcoming.push_back(from_record(records[i], strings));
+
+        // skip last session's month if it's not this one
+        if (header.month_begin == now.start_of_month().to_unix())
+            for (uint32_t i=header.n_upcoming; i<n_records; ++i)
+                month.push_back(from_record(records[i], strings));
+
+        return true;
+    }
+
+    void save_soon()
+    {
+        // the month and upcoming planners tend to change together
+        static constexpr int BATCH_SEC = 1;
+
+        if (m_save_tag == 0)
+            m_save_tag = g_timeout_add_seconds(BATCH_SEC, save_now_static, this);
+    }
+
+    static gboolean save_now_static(gpointer gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+        self->m_save_tag = 0;
+        self->save_now();
+        return G_SOURCE_REMOVE;
+    }
+
+    void save_now()
+    {
+        auto state = m_state.lock();
+        if (!state)
+            return;
+
+        // only save the month that we'll be showing at startup
+        const auto month_begin = state->clock->localtime().start_of_month();
+        AppointmentList month;
+        if (DateTime::is_same_day(state->calendar_month->month().get().start_of_month(), month_begin))
+            month = state->calendar_month->appointments().get();
+
+        save(month_begin, state->calendar_upcoming->appointments().get(), month);
+    }
+
+    const std::string m_filename;
+    std::weak_ptr<State> m_state;
+    std::vector<core::ScopedConnection> m_connections;
+    guint m_save_tag {};
+};
+
+/***
+****
+***/
+
+Snapshot::Snapshot(const std::string& filename):
+    p(new Impl(filename))
+{
+}
+
+Snapshot::~Snapshot() =default;
+
+void Snapshot::track(const std::shared_ptr<State>& state)
+{
+    p->track(state);
+}
+
+bool Snapshot::load(const DateTime& now,
+                    std::vector<Appointment>& upcoming,
+                    std::vector<Appointment>& month) const
+{
+    return p->load(now, upcoming, month);
+}
+
+void Snapshot::save(const DateTime& month_begin,
+                    const std::vector<Appointment>& upcoming,
+                    const std::vector<Appointment>& month) const
+{
+    p->save(month_begin, upcoming, month);
+}
+
+std::string Snapshot::default_filename()
+{
+    auto filename = g_build_filename(g_get_user_cache_dir(), GETTEXT_PACKAGE, "appointments.snapshot", nullptr);
+    std::string ret {filename};
+    g_free(filename);
+    return ret;
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/timer-service.h>
+
+#include <glib-unix.h> // g_unix_fd_add()
+
+#include <sys/timerfd.h>
+#include <unistd.h> // close(), read()
+
+#include <algorithm> // std::max()
+#include <cerrno>
+#include <map>
+#include <set>
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+ #define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+class TimerService::Impl
+{
+public:
+
+    Impl():
+        m_started(g_get_monotonic_time()),
+        m_offset(current_offset())
+    {
+        m_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK|TFD_CLOEXEC);
+        if (m_fd == -1)
+            g_error("unable to create realtime timer: %s", g_strerror(errno));
+
+        m_watch_tag = g_unix_fd_add(m_fd,
+                                    (GIOCondition)(G_IO_IN|G_IO_HUP|G_IO_ERR),
+                                    on_timerfd_cond,
+                                    this);
+        arm();
+    }
+
+    ~Impl()
+    {
+        if (m_watch_tag != 0)
+            g_source_remove(m_watch_tag);
+
+        if (m_fd != -1)
+            close(m_fd);
+    }
+
+    guint add(GTimeSpan deadline_usec, GTimeSpan tolerance_usec, bool wall_clock, Func&& func)
+    {
+        const auto tag = m_next_tag++;
+        if (m_next_tag == 0) // wrapped around
+            m_next_tag = 1;
+
+        Timer timer {deadline_usec, std::max(GTimeSpan{0}, tolerance_usec), wall_clock, std::move(func)};
+        insert(tag, std::move(timer));
+        arm();
+        return tag;
+    }
+
+    void remove(guint tag)
+    {
+        auto it = m_timers.find(tag);
+        if (it == m_timers.end())
+            return;
+
+        m_by_deadline.erase(std::make_pair(it->second.deadline, tag));
+        m_by_latest.erase(std::make_pair(it->second.latest(), tag));
+        m_timers.erase(it);
+        arm();
+    }
+
+    core::Signal<>& clock_set() { return m_clock_set; }
+
+    uint64_t wakeup_count() const { return m_wakeups; }
+
+    double wakeups_per_hour() const
+    {
+        const auto elapsed_usec = g_get_monotonic_time() - m_started;
+        if (elapsed_usec <= 0)
+            return 0;
+        return m_wakeups * (double(G_USEC_PER_SEC) * 60 * 60) / elapsed_usec;
+    }
+
+private:
+
+    struct Timer
+    {
+        GTimeSpan deadline; // wall-clock usec
+        GTimeSpan tolerance;
+        bool wall_clock;
+        Func func;
+
+        GTimeSpan latest() const { return deadline + tolerance; }
+    };
+
+    static GTimeSpan current_offset()
+    {
+        return g_get_real_time() - g_get_monotonic_time();
+    }
+
+    void insert(guint tag, Timer&& timer)
+    {
+        m_by_deadline.insert(std::make_pair(timer.deadline, tag));
+        m_by_latest.insert(std::make_pair(timer.latest(), tag));
+        m_timers.insert(std::make_pair(tag, std::move(timer)));
+    }
+
+    // wake up when the first timer's window closes;
+    // whatever else is due by then gets kicked too.
+    // With no timers, stay armed for the far future anyway:
+    // a disarmed timerfd never reports CANCEL_ON_SET.
+    void arm()
+    {
+        static constexpr GTimeSpan NEVER_USEC {G_GINT64_CONSTANT(253402300799) * G_USEC_PER_SEC}; // 9999-12-31
+
+        const GTimeSpan wakeup = m_by_latest.empty() ? NEVER_USEC : m_by_latest.begin()->first;
+        if (wakeup == m_armed_for)
+            return;
+
+        struct itimerspec spec {};
+        spec.it_value.tv_sec = wakeup / G_USEC_PER_SEC;
+        spec.it_value.tv_nsec = (wakeup % G_USEC_PER_SEC) * 1000;
+        if ((spec.it_value.tv_sec == 0) && (spec.it_value.tv_nsec == 0))
+            spec.it_value.tv_nsec = 1; // zero would disarm the timer
+
+        // also wake up if someone changes the time manually (eg toggling from manual<->ntp)
+        const int flags = TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET;
+        if (timerfd_settime(m_fd, flags, &spec, nullptr) == -1)
+            g_warning("%s timerfd_settime failed: %s", G_STRLOC, g_strerror(errno));
+        m_armed_for = wakeup;
+    }
+
+    static gboolean on_timerfd_cond(gint fd, GIOCondition cond, gpointer gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+
+        ssize_t n_bytes = 0;
+        uint64_t n_interrupts = 0;
+        if (cond & G_IO_IN)
+            n_bytes = read(fd, &n_interrupts, sizeof(uint64_t));
+
+        if ((n_bytes == -1) && (errno == ECANCELED))
+            self->on_clock_set();
+        else if (n_bytes == sizeof(uint64_t))
+            ++self->m_wakeups;
+
+        self->m_armed_for = 0; // the timer is spent or was cancelled; rearm it
+        self->dispatch();
+        return G_SOURCE_CONTINUE;
+    }
+
+    void on_clock_set()
+    {
+        // timers that count a delay shouldn't care that the wall clock moved
+        const auto offset = current_offset();
+        const auto shift = offset - m_offset;
+        m_offset = offset;
+        g_debug("%s wall clock was set; moved by %" G_GINT64_FORMAT " usec", G_STRFUNC, shift);
+
+        if (shift != 0)
+        {
+            std::map<guint,Timer> timers;
+            timers.swap(m_timers);
+            m_by_deadline.clear();
+            m_by_latest.clear();
+            for (auto& it : timers)
+            {
+                if (!it.second.wall_clock)
+                    it.second.deadline += shift;
+                insert(it.first, std::move(it.second));
+            }
+        }
+
+        m_clock_set();
+    }
+
+    void dispatch()
+    {
+        // timers may add or remove timers, so look again after each one
+        for (;;)
+        {
+            const auto now = g_get_real_time();
+            if (m_by_deadline.empty() || (now < m_by_deadline.begin()->first))
+                break;
+
+            const auto tag = m_by_deadline.begin()->second;
+            auto it = m_timers.find(tag);
+            auto func = std::move(it->second.func);
+            m_by_deadline.erase(m_by_deadline.begin());
+            m_by_latest.erase(std::make_pair(it->second.latest(), tag));
+            m_timers.erase(it);
+
+            func();
+        }
+
+        arm();
+    }
+
+    int m_fd = -1;
+    guint m_watch_tag = 0;
+    guint m_next_tag = 1;
+    GTimeSpan m_armed_for = 0;
+    const GTimeSpan m_started; // monotonic usec
+    GTimeSpan m_offset; // wall-clock minus monotonic usec
+    uint64_t m_wakeups = 0;
+    std::map<guint,Timer> m_timers;
+    std::set<std::pair<GTimeSpan,guint>> m_by_deadline;
+    std::set<std::pair<GTimeSpan,guint>> m_by_latest;
+    core::Signal<> m_clock_set;
+};
+
+/***
+****
+***/
+
+TimerService&
+TimerService::get_default()
+{
+    static TimerService service;
+    return service;
+}
+
+TimerService::TimerService():
+    p(new Impl())
+{
+}
+
+TimerService::~TimerService()
+{
+}
+
+guint
+TimerService::add(GTimeSpan delay_usec, GTimeSpan tolerance_usec, Func func)
+{
+    return p->add(g_get_real_time() + delay_usec, tolerance_usec, false, std::move(func));
+}
+
+guint
+TimerService::add_at(GTimeSpan deadline_usec, GTimeSpan tolerance_usec, Func func)
+{
+    return p->add(deadline_usec, tolerance_usec, true, std::move(func));
+}
+
+void
+TimerService::remove(guint& tag)
+{
+    if (tag != 0)
+    {
+        p->remove(tag);
+        tag = 0;
+    }
+}
+
+core::Signal<>&
+TimerService::clock_set()
+{
+    return p->clock_set();
+}
+
+uint64_t
+TimerService::wakeup_count() const
+{
+    return p->wakeup_count();
+}
+
+double
+TimerService::wakeups_per_hour() const
+{
+    return p->wakeups_per_hour();
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
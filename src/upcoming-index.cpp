@@ -0,0 +1,181 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/upcoming-index.h>
+
+#include <algorithm>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+namespace
+{
+    // the order we index in; the later keys just keep ties deterministic
+    bool begins_before(const Appointment* a, const Appointment* b)
+    {
+        if (a->begin != b->begin)
+            return a->begin < b->begin;
+        if (a->end != b->end)
+            return a->end < b->end;
+        if (a->summary != b->summary)
+            return a->summary < b->summary;
+        return a->uid < b->uid;
+    }
+
+    // the std heap functions build max-heaps, so invert this for a min-end heap
+    bool ends_after(const Appointment* a, const Appointment* b)
+    {
+        return a->end > b->end;
+    }
+} // unnamed namespace
+
+/***
+****
+***/
+
+void
+UpcomingIndex::set(const AppointmentList& appointments)
+{
+    if (m_snapshot == appointments.snapshot())
+        return;
+
+    m_snapshot = appointments.snapshot();
+    m_by_begin.clear();
+    m_by_begin.reserve(m_snapshot->size());
+    for (const auto& appointment : *m_snapshot)
+        m_by_begin.push_back(&appointment);
+
+    // the planners usually hand us a list that's already sorted
+    if (!std::is_sorted(m_by_begin.begin(), m_by_begin.end(), begins_before))
+        std::sort(m_by_begin.begin(), m_by_begin.end(), begins_before);
+
+    reset();
+}
+
+void
+UpcomingIndex::reset()
+{
+    m_cursor = 0;
+    m_started.clear();
+    m_now = DateTime();
+}
+
+void
+UpcomingIndex::advance(const DateTime& now, const DateTime& next_minute)
+{
+    // the heap only ever drops appointments, so start over if time went back
+    if (m_now.is_set() && (now < m_now))
+        reset();
+    m_now = now;
+
+    // move the appointments that have started onto the heap...
+    for ( ; (m_cursor < m_by_begin.size()) && (m_by_begin[m_cursor]->begin < next_minute); ++m_cursor)
+    {
+        const auto appointment = m_by_begin[m_cursor];
+        if (appointment->end >= now)
+        {
+            m_started.push_back(appointment);
+            std::push_heap(m_started.begin(), m_started.end(), ends_after);
+        }
+    }
+
+    // ...and drop the ones that have ended
+    while (!m_started.empty() && (m_started.front()->end < now))
+    {
+        std::pop_heap(m_started.begin(), m_started.end(), ends_after);
+        m_started.pop_back();
+    }
+}
+
+std::vector<Appointment>
+UpcomingIndex::get_display_appointments(const DateTime& now, unsigned int max_items)
+{
+    std::vector<Appointment> appointments;
+
+    if (!m_snapshot || !max_items)
+        return appointments;
+
+    const auto next_minute = now.add_full(0,0,0,0,1,-now.seconds());
+    const auto start_of_day = now.start_of_day();
+    const auto end_of_day = now.end_of_day();
+    advance(now, next_minute);
+
+    // sort the appointments that have started into their priority groups.
+    // this is usually a short list, since it's just what's happening now.
+    std::vector<const Appointment*> ending_today;
+    std::vector<const Appointment*> full_day_today;
+    std::vector<const Appointment*> others;
+    for (const auto appointment : m_started)
+    {
+        if (appointment->end <= end_of_day)
+            ending_today.push_back(appointment);
+        else if ((appointment->begin <= start_of_day) && (end_of_day <= appointment->end))
+            full_day_today.push_back(appointment);
+        else
+            others.push_back(appointment);
+    }
+
+    std::vector<const Appointment*> chosen;
+    auto take = [&chosen, max_items](std::vector<const Appointment*>& group) {
+        std::sort(group.begin(), group.end(), begins_before);
+        for (auto it=group.begin(); (it!=group.end()) && (chosen.size()<max_items); ++it)
+            chosen.push_back(*it);
+    };
+
+    // 1. events that end later today, and ones that haven't started yet.
+    //    those that have started come first since they began earlier.
+    take(ending_today);
+    for (auto i=m_cursor; (i<m_by_begin.size()) && (chosen.size()<max_items); ++i)
+        if (m_by_begin[i]->end >= now)
+            chosen.push_back(m_by_begin[i]);
+
+    // 2. full-day events that span all of today
+    take(full_day_today);
+
+    // 3. events that started before this minute and run past today
+    take(others);
+
+    // display them in chronological order;
+    // events with the same start+end are sorted alphabetically
+    std::sort(chosen.begin(), chosen.end(), [](const Appointment* a, const Appointment* b){
+        if (a->begin != b->begin)
+            return a->begin < b->begin;
+        if (a->end != b->end)
+            return a->end < b->end;
+        return a->summary < b->summary;
+    });
+
+    appointments.reserve(chosen.size());
+    for (const auto appointment : chosen)
+        appointments.push_back(*appointment);
+    return appointments;
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -152,57 +152,48 @@ typedef enum
 }
 date_proximity_t;
 
+#define N_DATE_PROXIMITIES (DATE_PROXIMITY_FAR+1)
+
 static date_proximity_t
-getDateProximity(GDateTime* now, GDateTime* time)
+getDateProximity(gint64 now_usec, gint64 now_day, gint64 time_usec, gint64 time_day)
 {
-    date_proximity_t prox = DATE_PROXIMITY_FAR;
-    gint now_year, now_month, now_day;
-    gint time_year, time_month, time_day;
-
     // did it already happen?
-    if (g_date_time_difference(time, now) < -G_USEC_PER_SEC)
+    if ((time_usec - now_usec) < -G_USEC_PER_SEC)
         return DATE_PROXIMITY_FAR;
 
-    // does it happen today?
-    g_date_time_get_ymd(now, &now_year, &now_month, &now_day);
-    g_date_time_get_ymd(time, &time_year, &time_month, &time_day);
-    if ((now_year == time_year) && (now_month == time_month) && (now_day == time_day))
-        prox = DATE_PROXIMITY_TODAY;
+    const gint64 days = time_day - now_day;
 
-    // does it happen tomorrow?
-    if (prox == DATE_PROXIMITY_FAR)
-    {
-        GDateTime* tomorrow = g_date_time_add_days(now, 1);
+    if (days == 0)
+        return DATE_PROXIMITY_TODAY;
 
-        gint tom_year, tom_month, tom_day;
-        g_date_time_get_ymd(tomorrow, &tom_year, &tom_month, &tom_day);
-        if ((tom_year == time_year) && (tom_month == time_month) && (tom_day == time_day))
-            prox = DATE_PROXIMITY_TOMORROW;
+    if (days == 1)
+        return DATE_PROXIMITY_TOMORROW;
 
-        g_date_time_unref(tomorrow);
-    }
+    if (days <= 6)
+        return DATE_PROXIMITY_WEEK;
 
-    // does it happen this week?
-    if (prox == DATE_PROXIMITY_FAR)
-    {
-        GDateTime* week = g_date_time_add_days(now, 6);
-        GDateTime* week_bound = g_date_time_new_local(g_date_time_get_year(week),
-                                                g_date_time_get_month(week),
-                                                g_date_time_get_day_of_month(week),
-                                                23, 59, 59.9);
+    return DATE_PROXIMITY_FAR;
+}
 
-        if (g_date_time_compare(time, week_bound) <= 0)
-            prox = DATE_PROXIMITY_WEEK;
+static gint64
+get_instant(GDateTime* dt)
+{
+    return g_date_time_to_unix(dt) * G_USEC_PER_SEC + g_date_time_get_microsecond(dt);
+}
 
-        g_date_time_unref(week_bound);
-        g_date_time_unref(week);
-    }
+/* days since the epoch, as seen from dt's own timezone */
+static gint64
+get_day_number(GDateTime* dt)
+{
+    const gint64 t = g_date_time_to_unix(dt) + g_date_time_get_utc_offset(dt) / G_USEC_PER_SEC;
+    const gint64 secs_per_day = 24 * 60 * 60;
 
-    return prox;
+    /* round down so that days before the epoch are numbered correctly */
+    return (t / secs_per_day) - ((t % secs_per_day) < 0 ? 1 : 0);
 }
 
-const char*
-T_(const char *msg)
+static const char*
+translate_in_time_locale(const char *msg)
 {
     /* General strategy here is to make sure LANGUAGE is empty (since that
        trumps all LC_* vars) and then to temporarily swap LC_TIME and
@@ -238,6 +229,175 @@ T_(const char *msg)
     return rv;
 }
 
+const char*
+T_(const char *msg)
+{
+    /* Swapping locales is expensive and T_() gets called for every
+       appointment and location each time the menu's rebuilt, so keep
+       a table of msgid -> translation for the current LC_TIME locale.
+       The answer doesn't depend on LC_MESSAGES or LANGUAGE since
+       translate_in_time_locale() overrides both.
+
+       The translations are interned, so the pointers we've handed out
+       stay valid even after the table's rebuilt for a new locale. */
+
+    static GHashTable* translations = NULL;
+    static gchar* translations_locale = NULL;
+
+    const char* time_locale = setlocale(LC_TIME, NULL);
+    if ((translations == NULL) || g_strcmp0(time_locale, translations_locale))
+    {
+        g_clear_pointer(&translations, g_hash_table_destroy);
+        g_free(translations_locale);
+        translations = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        translations_locale = g_strdup(time_locale);
+    }
+
+    const char* rv = g_hash_table_lookup(translations, msg);
+    if (rv == NULL)
+    {
+        rv = g_intern_string(translate_in_time_locale(msg));
+        g_hash_table_insert(translations, g_strdup(msg), (gpointer)rv);
+    }
+
+    return rv;
+}
+
+
+static const char*
+lookup_relative_format(date_proximity_t prox, gboolean full_day, gboolean twelvehour)
+{
+    if (full_day)
+    {
+        switch (prox)
+        {
+            case DATE_PROXIMITY_TODAY:
+                return T_("Today");
+
+            case DATE_PROXIMITY_TOMORROW:
+                return T_("Tomorrow");
+
+            case DATE_PROXIMITY_WEEK:
+                /* This is a strftime(3) format string indicating the unabbreviated weekday. */
+                return T_("%A");
+
+            case DATE_PROXIMITY_FAR:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing full-day events that are over a week away.
+                   en_US example: "%a %b %d" --> "Sat Oct 31"
+                   en_GB example: "%a %d %b" --> "Sat 31 Oct"
+                   zh_CN example(?): "%m月%d日 周%a" --> "10月31日 周六" */
+                return T_("%a %d %b");
+        }
+    }
+    else if (twelvehour)
+    {
+        switch (prox)
+        {
+            case DATE_PROXIMITY_TODAY:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 12-hour clock, events/appointments that happen today.
+                   en_US example: "%l:%M %p" --> "1:00 PM" */
+                return T_("%l:%M %p");
+
+            case DATE_PROXIMITY_TOMORROW:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 12-hour clock, events/appointments that happen tomorrow.
+                   (Note: the space between the day and the time is an em space (unicode character 2003), which is
+                   slightly wider than a normal space.)
+                   en_US example: "Tomorrow %l:%M %p" --> "Tomorrow 1:00 PM" */
+                return T_("Tomorrow %l:%M %p");
+
+            case DATE_PROXIMITY_WEEK:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 12-hour clock, events/appointments that happen this week.
+                   (Note: the space between the day and the time is an em space (unicode character 2003), which is
+                   slightly wider than a normal space.)
+                   en_US example: "Tomorrow %l:%M %p" --> "Fri 1:00 PM" */
+                return T_("%a %l:%M %p");
+
+            case DATE_PROXIMITY_FAR:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 12-hour clock, events/appointments that happen over a week from now.
+                   (Note: the space between the day and the time is an em space (unicode character 2003), which is
+                   slightly wider than a normal space.)
+                   en_US example: "%a %b %d %l:%M %p" --> "Fri Oct 31 1:00 PM"
+                   en_GB example: "%a %d %b %l:%M %p" --> "Fri 31 Oct 1:00 PM" */
+                return T_("%a %d %b %l:%M %p");
+        }
+    }
+    else
+    {
+        switch (prox)
+        {
+            case DATE_PROXIMITY_TODAY:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 24-hour clock, events/appointments that happen today.
+                   en_US example: "%H:%M" --> "13:00" */
+                return T_("%H:%M");
+
+            case DATE_PROXIMITY_TOMORROW:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 24-hour clock, events/appointments that happen tomorrow.
+                   (Note: the space between the day and the time is an em space (unicode character 2003), which is
+                   slightly wider than a normal space.)
+                   en_US example: "Tomorrow %l:%M %p" --> "Tomorrow 13:00" */
+                return T_("Tomorrow %H:%M");
+
+            case DATE_PROXIMITY_WEEK:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 24-hour clock, events/appointments that happen this week.
+                   (Note: the space between the day and the time is an em space (unicode character 2003), which is
+                   slightly wider than a normal space.)
+                   en_US example: "%a %H:%M" --> "Fri 13:00" */
+                return T_("%a %H:%M");
+
+            case DATE_PROXIMITY_FAR:
+                /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
+                   This format string is used for showing, on a 24-hour clock, events/appointments that happen over a week from now.
+                   (Note: the space between the day and the time is an em space (unicode character 2003), which is
+                   slightly wider than a normal space.)
+                   en_US example: "%a %b %d %H:%M" --> "Fri Oct 31 13:00"
+                   en_GB example: "%a %d %b %H:%M" --> "Fri 31 Oct 13:00" */
+                return T_("%a %d %b %H:%M");
+        }
+    }
+
+
+    g_assert_not_reached();
+    return NULL;
+}
+
+const char*
+get_relative_format_string(gint64 now_usec, gint64 now_day,
+                           gint64 then_usec, gint64 then_day,
+                           gboolean full_day)
+{
+    /* The answer only depends on the proximity bucket, full_day,
+       and the LC_TIME locale (which also decides 12h vs. 24h),
+       so look each one up once and reuse it until the locale changes.
+       The strings come from T_(), so they stay valid after a reset. */
+
+    static const char* formats[2][N_DATE_PROXIMITIES];
+    static gboolean twelvehour = FALSE;
+    static gchar* formats_locale = NULL;
+
+    const char* time_locale = setlocale(LC_TIME, NULL);
+    if ((formats_locale == NULL) || g_strcmp0(time_locale, formats_locale))
+    {
+        memset(formats, 0, sizeof(formats));
+        twelvehour = is_locale_12h();
+        g_free(formats_locale);
+        formats_locale = g_strdup(time_locale);
+    }
+
+    const date_proximity_t prox = getDateProximity(now_usec, now_day, then_usec, then_day);
+    const char** fmt = &formats[full_day ? 1 : 0][prox];
+    if (*fmt == NULL)
+        *fmt = lookup_relative_format(prox, full_day, twelvehour);
+
+    return *fmt;
+}
 
 /**
  * _ a time today should be shown as just the time (e.g. “3:55 PM”)
@@ -264,115 +424,10 @@ char* generate_full_format_string_at_time (GDateTime* now,
     if (then != NULL)
     {
         const gboolean full_day = then_end && (g_date_time_difference(then_end, then) >= G_TIME_SPAN_DAY);
-        const date_proximity_t prox = getDateProximity(now, then);
 
-        if (full_day)
-        {
-            switch (prox)
-            {
-                case DATE_PROXIMITY_TODAY:
-                    g_string_assign (ret, T_("Today"));
-                    break;
-
-                case DATE_PROXIMITY_TOMORROW:
-                    g_string_assign (ret, T_("Tomorrow"));
-                    break;
-
-                case DATE_PROXIMITY_WEEK:
-                    /* This is a strftime(3) format string indicating the unabbreviated weekday. */
-                    g_string_assign (ret, T_("%A"));
-                    break;
-
-                case DATE_PROXIMITY_FAR:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing full-day events that are over a week away.
-                       en_US example: "%a %b %d" --> "Sat Oct 31"
-                       en_GB example: "%a %d %b" --> "Sat 31 Oct"
-                       zh_CN example(?): "%m月%d日 周%a" --> "10月31日 周六" */
-                    g_string_assign (ret, T_("%a %d %b"));
-                    break;
-            }
-        }
-        else if (is_locale_12h())
-        {
-            switch (prox)
-            {
-                case DATE_PROXIMITY_TODAY:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 12-hour clock, events/appointments that happen today.
-                       en_US example: "%l:%M %p" --> "1:00 PM" */
-                    g_string_assign (ret, T_("%l:%M %p"));
-                    break;
-
-                case DATE_PROXIMITY_TOMORROW:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 12-hour clock, events/appointments that happen tomorrow.
-                       (Note: the space between the day and the time is an em space (unicode character 2003), which is
-                       slightly wider than a normal space.)
-                       en_US example: "Tomorrow %l:%M %p" --> "Tomorrow 1:00 PM" */
-                    g_string_assign (ret, T_("Tomorrow %l:%M %p"));
-                    break;
-
-                case DATE_PROXIMITY_WEEK:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 12-hour clock, events/appointments that happen this week.
-                       (Note: the space between the day and the time is an em space (unicode character 2003), which is
-                       slightly wider than a normal space.)
-                       en_US example: "Tomorrow %l:%M %p" --> "Fri 1:00 PM" */
-                    g_string_assign (ret, T_("%a %l:%M %p"));
-                    break;
-
-                case DATE_PROXIMITY_FAR:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 12-hour clock, events/appointments that happen over a week from now.
-                       (Note: the space between the day and the time is an em space (unicode character 2003), which is
-                       slightly wider than a normal space.)
-                       en_US example: "%a %b %d %l:%M %p" --> "Fri Oct 31 1:00 PM"
-                       en_GB example: "%a %d %b %l:%M %p" --> "Fri 31 Oct 1:00 PM" */
-                    g_string_assign (ret, T_("%a %d %b %l:%M %p"));
-                    break;
-            }
-        }
-        else
-        {
-            switch (prox)
-            {
-                case DATE_PROXIMITY_TODAY:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 24-hour clock, events/appointments that happen today.
-                       en_US example: "%H:%M" --> "13:00" */
-                    g_string_assign (ret, T_("%H:%M"));
-                    break;
-
-                case DATE_PROXIMITY_TOMORROW:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 24-hour clock, events/appointments that happen tomorrow.
-                       (Note: the space between the day and the time is an em space (unicode character 2003), which is
-                       slightly wider than a normal space.)
-                       en_US example: "Tomorrow %l:%M %p" --> "Tomorrow 13:00" */
-                    g_string_assign (ret, T_("Tomorrow %H:%M"));
-                    break;
-
-                case DATE_PROXIMITY_WEEK:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 24-hour clock, events/appointments that happen this week.
-                       (Note: the space between the day and the time is an em space (unicode character 2003), which is
-                       slightly wider than a normal space.)
-                       en_US example: "%a %H:%M" --> "Fri 13:00" */
-                    g_string_assign (ret, T_("%a %H:%M"));
-                    break;
-
-                case DATE_PROXIMITY_FAR:
-                    /* Translators, please edit/rearrange these strftime(3) tokens to suit your locale!
-                       This format string is used for showing, on a 24-hour clock, events/appointments that happen over a week from now.
-                       (Note: the space between the day and the time is an em space (unicode character 2003), which is
-                       slightly wider than a normal space.)
-                       en_US example: "%a %b %d %H:%M" --> "Fri Oct 31 13:00"
-                       en_GB example: "%a %d %b %H:%M" --> "Fri 31 Oct 13:00" */
-                    g_string_assign (ret, T_("%a %d %b %H:%M"));
-                    break;
-            }
-        }
+        g_string_assign (ret, get_relative_format_string(get_instant(now), get_day_number(now),
+                                                         get_instant(then), get_day_number(then),
+                                                         full_day));
 
         /* if it's an appointment in a different timezone (and doesn't run for a full day)
            then the time should be followed by its timezone. */
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/wakeup-timer-timerfd.h>
+
+#include <datetime/timer-service.h>
+
+#include <glib.h>
+
+#include <algorithm> // std::max()
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+class TimerfdWakeupTimer::Impl
+{
+
+public:
+
+    Impl(const std::shared_ptr<Clock>& clock,
+         const std::shared_ptr<WakeupTimer>& hardware_timer):
+        m_clock(clock),
+        m_hardware_timer(hardware_timer)
+    {
+        if (m_hardware_timer)
+            m_hardware_connection.reset(new core::ScopedConnection(m_hardware_timer->timeout().connect([this](){
+                g_debug("%s hardware timer woke us up", G_STRLOC);
+                m_timeout();
+            })));
+    }
+
+    ~Impl()
+    {
+        TimerService::get_default().remove(m_timer_tag);
+    }
+
+    void set_wakeup_time(const DateTime& d)
+    {
+        m_wakeup_time = d;
+
+        rebuild_timer();
+
+        if (m_hardware_timer)
+            m_hardware_timer->set_wakeup_time(d);
+    }
+
+    core::Signal<>& timeout() { return m_timeout; }
+
+private:
+
+    void rebuild_timer()
+    {
+        TimerService::get_default().remove(m_timer_tag);
+
+        g_return_if_fail(m_wakeup_time.is_set());
+
+        auto dt = m_wakeup_time.get();
+        const auto deadline_usec = g_date_time_to_unix(dt)*G_USEC_PER_SEC + g_date_time_get_microsecond(dt);
+
+        g_debug("%s setting wakeup timer to kick at %s, which is in %zu msec",
+                G_STRFUNC,
+                m_wakeup_time.format("%F %T").c_str(),
+                size_t(std::max(GTimeSpan{0}, m_wakeup_time - m_clock->localtime()) / 1000));
+
+        // alarms should kick on time, so don't allow any slack.
+        // if the deadline has already passed, the timer kicks right away.
+        m_timer_tag = TimerService::get_default().add_at(deadline_usec, 0, [this](){
+            g_debug("%s %s", G_STRLOC, G_STRFUNC);
+            m_timer_tag = 0;
+            m_timeout();
+        });
+    }
+
+    core::Signal<> m_timeout;
+    const std::shared_ptr<Clock>& m_clock;
+    const std::shared_ptr<WakeupTimer> m_hardware_timer;
+    std::unique_ptr<core::ScopedConnection> m_hardware_connection;
+    guint m_timer_tag = 0;
+    DateTime m_wakeup_time;
+};
+
+/***
+****
+***/
+
+TimerfdWakeupTimer::TimerfdWakeupTimer(const std::shared_ptr<Clock>& clock,
+                                       const std::shared_ptr<WakeupTimer>& hardware_timer):
+    p(new Impl(clock, hardware_timer))
+{
+}
+
+TimerfdWakeupTimer::~TimerfdWakeupTimer()
+{
+}
+
+void TimerfdWakeupTimer::set_wakeup_time(const DateTime& d)
+{
+    p->set_wakeup_time(d);
+}
+
+core::Signal<>& TimerfdWakeupTimer::timeout()
+{
+    return p->timeout();
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -40,11 +40,11 @@ public:
 
     ~MockRangePlanner() =default;
 
-    core::Property<std::vector<Appointment>>& appointments() { return m_appointments; }
+    core::Property<AppointmentList>& appointments() { return m_appointments; }
     core::Property<std::pair<DateTime,DateTime>>& range() { return m_range; }
 
 private:
-    core::Property<std::vector<Appointment>> m_appointments;
+    core::Property<AppointmentList> m_appointments;
     core::Property<std::pair<DateTime,DateTime>> m_range;
 };
  
@@ -23,9 +23,16 @@
 #include <gtest/gtest.h>
 
 #include "state-fixture.h"
+#include "wakeup-timer-mock.h"
+
+#include <algorithm> // std::max()
 
 using namespace unity::indicator::datetime;
 
+/***
+****
+***/
+
 class AlarmQueueFixture: public StateFixture
 {
 private:
@@ -166,3 +173,71 @@ TEST_F(AlarmQueueFixture, NoDuplicates)
     ASSERT_EQ(1, m_triggered.size());
     EXPECT_EQ(a[0].uid, m_triggered[0]);
 }
+
+
+TEST_F(AlarmQueueFixture, BoundedBookkeepingOverMonths)
+{
+    static constexpr int N_DAYS {365};
+    static constexpr int N_DAYS_PLANNED {7}; // like the upcoming planner's window
+    static constexpr int ALARMS_PER_DAY {4};
+    static constexpr int WARMUP_DAYS {30};
+
+    // run a queue on its own planner, with a timer driven by the mock clock
+    auto planner = std::make_shared<MockRangePlanner>();
+    auto timer = std::make_shared<MockWakeupTimer>(m_state->clock);
+    SimpleAlarmQueue queue(m_state->clock, planner, timer);
+    int n_triggered = 0;
+    queue.alarm_reached().connect([&n_triggered](const Appointment&, const Alarm&){
+        ++n_triggered;
+    });
+
+    const auto first_day = m_state->clock->localtime().add_days(1).start_of_day();
+    auto make_day = [first_day](int day){
+        std::vector<Appointment> appointments;
+        for (int i=0; i<ALARMS_PER_DAY; ++i) {
+            Appointment a;
+            a.uid = "day-" + std::to_string(day) + "-" + std::to_string(i);
+            a.summary = "Summary";
+            a.type = Appointment::UBUNTU_ALARM;
+            a.begin = first_day.add_days(day).add_full(0,0,0,8+3*i,0,0);
+            a.end = a.begin.add_full(0,0,0,1,0,0);
+            a.alarms.push_back(Alarm{"Alarm Text", "", a.begin});
+            appointments.push_back(a);
+        }
+        return appointments;
+    };
+
+    size_t max_pending {0};
+    size_t max_triggered {0};
+    for (int day=0; day<N_DAYS; ++day)
+    {
+        // slide the planner's window forward a day
+        std::vector<Appointment> window;
+        for (int i=day; i<day+N_DAYS_PLANNED; ++i) {
+            auto appointments = make_day(i);
+            window.insert(window.end(), appointments.begin(), appointments.end());
+        }
+        planner->appointments().set(window);
+        EXPECT_EQ(window.size(), queue.alarm_count());
+
+        // and live through the day's alarms
+        for (int i=0; i<ALARMS_PER_DAY; ++i)
+            m_mock_state->mock_clock->set_localtime(window[i].begin);
+
+        max_pending = std::max(max_pending, queue.pending_count());
+        max_triggered = std::max(max_triggered, queue.triggered_count());
+    }
+
+    g_message("after %d simulated days and %d alarms, at most %zu alarms were queued and %zu remembered",
+              N_DAYS, n_triggered, max_pending, max_triggered);
+
+    EXPECT_EQ(N_DAYS*ALARMS_PER_DAY, n_triggered);
+
+    // stale queue entries get compacted away...
+    const size_t n_planned = N_DAYS_PLANNED * ALARMS_PER_DAY;
+    EXPECT_LE(max_pending, std::max(size_t{64}, 2*n_planned));
+
+    // ...and alarms are forgotten soon after they leave the planner,
+    // so at most today's and yesterday's are remembered
+    EXPECT_LE(max_triggered, size_t(2*ALARMS_PER_DAY));
+}
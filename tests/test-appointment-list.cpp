@@ -0,0 +1,133 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include "glib-fixture.h"
+#include "planner-mock.h"
+
+#include <datetime/appointment.h>
+#include <datetime/planner-aggregate.h>
+#include <datetime/planner-upcoming.h>
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+class AppointmentListFixture: public GlibFixture
+{
+private:
+
+    typedef GlibFixture super;
+
+protected:
+
+    std::vector<Appointment> build_appointments(int n)
+    {
+        const auto now = DateTime::NowLocal();
+
+        std::vector<Appointment> appointments;
+        for (int i=0; i<n; ++i)
+        {
+            Appointment a;
+            a.uid = "some-long-enough-uid-" + std::to_string(i);
+            a.source_uid = "some-long-enough-source-uid";
+            a.summary = "An appointment with a summary that isn't tiny";
+            a.color = "#00FF00";
+            a.begin = now.add_full(0,0,0,i,0,0);
+            a.end = a.begin.add_full(0,0,0,1,0,0);
+            appointments.push_back(a);
+        }
+        return appointments;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(AppointmentListFixture, ReadsLikeAVector)
+{
+    const auto appointments = build_appointments(3);
+
+    AppointmentList list(appointments);
+    EXPECT_EQ(appointments, list);
+    EXPECT_EQ(list, appointments);
+    EXPECT_EQ(3u, list.size());
+    EXPECT_EQ(appointments[1], list[1]);
+    EXPECT_EQ(appointments.front(), list.front());
+
+    // copies share the same snapshot
+    const auto copy = list;
+    EXPECT_EQ(list.snapshot(), copy.snapshot());
+
+    // and converting back gives an independent vector
+    std::vector<Appointment> v = copy;
+    v.pop_back();
+    EXPECT_EQ(3u, copy.size());
+    EXPECT_NE(v, copy);
+
+    EXPECT_TRUE(AppointmentList().empty());
+}
+
+TEST_F(AppointmentListFixture, PlannersShareOneSnapshot)
+{
+    auto range_planner = std::make_shared<MockRangePlanner>();
+    auto upcoming = std::make_shared<UpcomingPlanner>(range_planner, DateTime::NowLocal());
+    AggregatePlanner aggregate;
+    aggregate.add(upcoming);
+
+    range_planner->appointments().set(build_appointments(10));
+
+    const auto& snapshot = range_planner->appointments().get().snapshot();
+    EXPECT_EQ(snapshot, upcoming->appointments().get().snapshot());
+    EXPECT_EQ(snapshot, aggregate.appointments().get().snapshot());
+}
+
+TEST_F(AppointmentListFixture, RebuildsAreNotCopied)
+{
+    static constexpr int N_APPOINTMENTS {500};
+    static constexpr int N_CONSUMERS {4}; // e.g. the menu profiles
+
+    // wire up some consumers
+    auto range_planner = std::make_shared<MockRangePlanner>();
+    auto upcoming = std::make_shared<UpcomingPlanner>(range_planner, DateTime::NowLocal());
+    AggregatePlanner aggregate;
+    aggregate.add(upcoming);
+    std::vector<AppointmentList> kept(N_CONSUMERS);
+    std::vector<core::ScopedConnection> connections;
+    for (int i=0; i<N_CONSUMERS; ++i)
+        connections.push_back(aggregate.appointments().changed().connect([&kept, i](const AppointmentList& a){
+            kept[i] = a;
+        }));
+
+    // hand a rebuild to every consumer
+    const AppointmentList rebuild(build_appointments(N_APPOINTMENTS));
+    range_planner->appointments().set(rebuild);
+
+    // nobody should have needed a copy of their own
+    EXPECT_EQ(rebuild.snapshot(), range_planner->appointments().get().snapshot());
+    EXPECT_EQ(rebuild.snapshot(), upcoming->appointments().get().snapshot());
+    EXPECT_EQ(rebuild.snapshot(), aggregate.appointments().get().snapshot());
+    for (const auto& list : kept)
+    {
+        EXPECT_EQ(size_t(N_APPOINTMENTS), list.size());
+        EXPECT_EQ(rebuild.snapshot(), list.snapshot());
+    }
+}
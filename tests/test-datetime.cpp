@@ -21,6 +21,10 @@
 
 #include "glib-fixture.h"
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 using namespace unity::indicator::datetime;
 
 /***
@@ -141,3 +145,97 @@ TEST_F(DateTimeFixture, StartAndEnd)
     }
 }
 
+
+TEST_F(DateTimeFixture, InstantMatchesCalendar)
+{
+    const int n_iterations{10000};
+
+    for (int i{0}; i<n_iterations; ++i)
+    {
+        const auto day = random_day();
+
+        // a DateTime built from an instant should agree with GDateTime
+        const auto t = day.to_unix();
+        const auto copy = DateTime::Local(t);
+        EXPECT_EQ(t, g_date_time_to_unix(copy.get()));
+        EXPECT_EQ(day.start_of_minute(), copy.start_of_minute());
+
+        // absolute offsets should match g_date_time_add_full()
+        auto gdt = g_date_time_add_full(day.get(), 0, 0, 0, 1, -2, 3.5);
+        const auto moved = day.add_full(0, 0, 0, 1, -2, 3.5);
+        EXPECT_EQ(0, g_date_time_compare(gdt, moved.get()));
+        EXPECT_EQ(g_date_time_difference(gdt, day.get()), moved - day);
+        g_date_time_unref(gdt);
+    }
+}
+
+/***
+****
+***/
+
+namespace
+{
+    /**
+     * The GDateTime-backed DateTime we used before, to benchmark against
+     */
+    class LegacyDateTime
+    {
+    public:
+        LegacyDateTime(GTimeZone* gtz, time_t t)
+        {
+            auto utc = g_date_time_new_from_unix_utc(t);
+            auto gdt = g_date_time_to_timezone(utc, gtz);
+            m_tz.reset(g_time_zone_ref(gtz), g_time_zone_unref);
+            m_dt.reset(gdt, g_date_time_unref);
+            g_date_time_unref(utc);
+        }
+        bool operator<(const LegacyDateTime& that) const {return g_date_time_compare(m_dt.get(), that.m_dt.get()) < 0;}
+        int64_t operator-(const LegacyDateTime& that) const {return g_date_time_difference(m_dt.get(), that.m_dt.get());}
+        int64_t to_unix() const {return g_date_time_to_unix(m_dt.get());}
+    private:
+        std::shared_ptr<GTimeZone> m_tz;
+        std::shared_ptr<GDateTime> m_dt;
+    };
+
+    template<typename T>
+    gint64 benchmark(const std::vector<time_t>& times, GTimeZone* gtz, std::vector<int64_t>& setme)
+    {
+        const auto begin = g_get_monotonic_time();
+
+        std::vector<T> v;
+        v.reserve(times.size());
+        for (const auto& t : times)
+            v.push_back(T(gtz, t));
+        auto copy = v;
+        std::sort(copy.begin(), copy.end());
+        int64_t span = 0;
+        for (size_t i=1; i<copy.size(); ++i)
+            span += copy[i] - copy[i-1];
+
+        setme.clear();
+        for (const auto& dt : copy)
+            setme.push_back(dt.to_unix());
+        setme.push_back(span);
+
+        return g_get_monotonic_time() - begin;
+    }
+}
+
+TEST_F(DateTimeFixture, Benchmark)
+{
+    const int n_times{100000};
+
+    std::vector<time_t> times;
+    for (int i{0}; i<n_times; ++i)
+        times.push_back(g_rand_int_range(m_rand, 0, G_MAXINT32));
+
+    auto gtz = g_time_zone_new_local();
+    std::vector<int64_t> legacy_results, results;
+    const auto legacy_usec = benchmark<LegacyDateTime>(times, gtz, legacy_results);
+    const auto usec = benchmark<DateTime>(times, gtz, results);
+    g_time_zone_unref(gtz);
+
+    g_message("create/copy/sort/subtract %d times: GDateTime-backed %.1f ms, compact %.1f ms",
+              n_times, legacy_usec/1000.0, usec/1000.0);
+    EXPECT_EQ(legacy_results, results);
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include "glib-fixture.h"
+#include "timezone-mock.h"
+
+#include <datetime/engine-cache.h>
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+namespace
+{
+    /**
+     * An Engine that remembers which ranges it was asked for
+     * and answers with whichever of its appointments overlap them.
+     */
+    class CountingEngine: public Engine
+    {
+    public:
+        void get_appointments(const DateTime& begin,
+                              const DateTime& end,
+                              const Timezone& /*default_timezone*/,
+                              std::function<void(const std::vector<Appointment>&)> func,
+                              GCancellable* /*cancellable*/) override {
+            requests.push_back(std::make_pair(begin, end));
+            std::vector<Appointment> ret;
+            for (const auto& appt : appointments)
+                if (!(appt.end < begin) && !(end < appt.begin))
+                    ret.push_back(appt);
+            func(ret);
+        }
+        void disable_ubuntu_alarm(const Appointment&) override {}
+        core::Signal<>& changed() override {return m_changed;}
+
+        std::vector<Appointment> appointments;
+        std::vector<std::pair<DateTime,DateTime>> requests;
+
+    private:
+        core::Signal<> m_changed;
+    };
+
+    Appointment create_appointment(const std::string& uid, const DateTime& begin)
+    {
+        Appointment a;
+        a.uid = uid;
+        a.summary = uid;
+        a.begin = begin;
+        a.end = begin.add_full(0,0,0,1,0,0);
+        return a;
+    }
+
+    std::vector<Appointment> get(Engine& engine, const DateTime& begin, const DateTime& end, const Timezone& tz)
+    {
+        std::vector<Appointment> ret;
+        bool called {};
+        engine.get_appointments(begin, end, tz, [&ret, &called](const std::vector<Appointment>& appts){
+            ret = appts;
+            called = true;
+        }, nullptr);
+        EXPECT_TRUE(called);
+        return ret;
+    }
+}
+
+class EngineCacheFixture: public GlibFixture
+{
+private:
+    typedef GlibFixture super;
+
+protected:
+    std::shared_ptr<CountingEngine> m_counting;
+    std::shared_ptr<CacheEngine> m_cache;
+    std::shared_ptr<MockTimezone> m_tz;
+
+    void SetUp() override
+    {
+        super::SetUp();
+
+        m_tz.reset(new MockTimezone("America/Chicago"));
+        m_counting.reset(new CountingEngine);
+        m_counting->appointments.push_back(create_appointment("a", DateTime::Local(2015, 5, 3, 9, 0, 0)));
+        m_counting->appointments.push_back(create_appointment("b", DateTime::Local(2015, 5, 20, 9, 0, 0)));
+        m_counting->appointments.push_back(create_appointment("c", DateTime::Local(2015, 6, 10, 9, 0, 0)));
+        m_cache.reset(new CacheEngine(m_counting));
+    }
+
+    void TearDown() override
+    {
+        m_cache.reset();
+        m_counting.reset();
+        m_tz.reset();
+
+        super::TearDown();
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(EngineCacheFixture, ServesCoveredRangesFromMemory)
+{
+    const auto month_begin = DateTime::Local(2015, 5, 1, 0, 0, 0);
+    const auto month_end = month_begin.end_of_month();
+
+    auto appts = get(*m_cache, month_begin, month_end, *m_tz);
+    ASSERT_EQ(2, appts.size());
+    EXPECT_EQ("a", appts[0].uid);
+    EXPECT_EQ("b", appts[1].uid);
+    EXPECT_EQ(1, m_counting->requests.size());
+
+    // a subrange of what we've already got shouldn't touch the engine
+    appts = get(*m_cache, month_begin.add_days(10), month_end, *m_tz);
+    ASSERT_EQ(1, appts.size());
+    EXPECT_EQ("b", appts[0].uid);
+    EXPECT_EQ(1, m_counting->requests.size());
+}
+
+TEST_F(EngineCacheFixture, FetchesOnlyTheGaps)
+{
+    const auto month_begin = DateTime::Local(2015, 5, 1, 0, 0, 0);
+    const auto month_end = month_begin.end_of_month();
+    get(*m_cache, month_begin, month_end, *m_tz);
+    ASSERT_EQ(1, m_counting->requests.size());
+
+    // an 'upcoming' range that straddles the end of the month
+    const auto upcoming_begin = DateTime::Local(2015, 5, 15, 0, 0, 0);
+    const auto upcoming_end = upcoming_begin.add_full(0,1,0,0,0,0);
+    auto appts = get(*m_cache, upcoming_begin, upcoming_end, *m_tz);
+    ASSERT_EQ(2, appts.size());
+    EXPECT_EQ("b", appts[0].uid);
+    EXPECT_EQ("c", appts[1].uid);
+
+    // confirm that only the uncovered tail was fetched
+    ASSERT_EQ(2, m_counting->requests.size());
+    EXPECT_EQ(month_end, m_counting->requests[1].first);
+    EXPECT_EQ(upcoming_end, m_counting->requests[1].second);
+}
+
+TEST_F(EngineCacheFixture, FlushesWhenEngineChanges)
+{
+    const auto month_begin = DateTime::Local(2015, 5, 1, 0, 0, 0);
+    const auto month_end = month_begin.end_of_month();
+    get(*m_cache, month_begin, month_end, *m_tz);
+    ASSERT_EQ(1, m_counting->requests.size());
+
+    // confirm the cache re-emits the engine's changed() signal
+    bool changed {};
+    m_cache->changed().connect([&changed](){changed = true;});
+    m_counting->appointments.push_back(create_appointment("d", DateTime::Local(2015, 5, 25, 9, 0, 0)));
+    m_counting->changed()();
+    EXPECT_TRUE(changed);
+
+    // confirm the next request goes back to the engine
+    auto appts = get(*m_cache, month_begin, month_end, *m_tz);
+    EXPECT_EQ(3, appts.size());
+    EXPECT_EQ(2, m_counting->requests.size());
+}
+
+TEST_F(EngineCacheFixture, FlushesWhenTimezoneChanges)
+{
+    const auto month_begin = DateTime::Local(2015, 5, 1, 0, 0, 0);
+    const auto month_end = month_begin.end_of_month();
+    get(*m_cache, month_begin, month_end, *m_tz);
+    get(*m_cache, month_begin, month_end, *m_tz);
+    EXPECT_EQ(1, m_counting->requests.size());
+
+    m_tz->timezone.set("Europe/Berlin");
+    get(*m_cache, month_begin, month_end, *m_tz);
+    EXPECT_EQ(2, m_counting->requests.size());
+}
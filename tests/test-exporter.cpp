@@ -247,3 +247,58 @@ TEST_F(ExporterFixture, AlarmProperties)
     // cleanup
     g_clear_object(&proxy);
 }
+
+TEST_F(ExporterFixture, MenusSleepWithoutSubscribers)
+{
+    auto state = std::make_shared<MockState>();
+    auto actions = std::make_shared<MockActions>(state);
+    auto settings = std::make_shared<Settings>();
+    std::vector<std::shared_ptr<Menu>> menus;
+
+    MenuFactory menu_factory (actions, state);
+    for(int i=0; i<Menu::NUM_PROFILES; i++)
+      menus.push_back(menu_factory.buildMenu(Menu::Profile(i)));
+
+    Exporter exporter(settings);
+    exporter.publish(actions, menus);
+    wait_msec();
+
+    // nobody's subscribed yet
+    for (const auto& menu : menus)
+        EXPECT_FALSE(menu->subscribed.get());
+
+    // so changing the state shouldn't rebuild anything
+    auto& desktop = menus[Menu::Desktop];
+    const auto executed = desktop->rebuilds_executed();
+    state->locations->locations.set(std::vector<Location>({Location("America/Chicago", "Dallas")}));
+    state->mock_clock->set_localtime(state->clock->localtime().add_full(0,0,0,0,1,0));
+    wait_msec();
+    EXPECT_EQ(executed, desktop->rebuilds_executed());
+
+    // subscribe to the desktop menu; it should wake up and catch up once
+    auto connection = g_bus_get_sync (G_BUS_TYPE_SESSION, nullptr, nullptr);
+    const auto path = std::string(BUS_DATETIME_PATH) + "/" + desktop->name();
+    auto model = G_MENU_MODEL(g_dbus_menu_model_get(connection, BUS_DATETIME_NAME, path.c_str()));
+    g_menu_model_get_n_items(model); // starts watching the menu
+    wait_msec(200);
+    EXPECT_TRUE(desktop->subscribed.get());
+    EXPECT_LT(executed, desktop->rebuilds_executed());
+    for (const auto& menu : menus)
+        if (menu != desktop)
+            EXPECT_FALSE(menu->subscribed.get());
+
+    // the other menus are still asleep
+    auto& phone = menus[Menu::Phone];
+    const auto phone_executed = phone->rebuilds_executed();
+    state->locations->locations.set(std::vector<Location>({Location("Europe/London", "London")}));
+    wait_msec();
+    EXPECT_EQ(phone_executed, phone->rebuilds_executed());
+
+    // unsubscribe; the desktop menu should go back to sleep
+    g_clear_object(&model);
+    wait_msec(200);
+    EXPECT_FALSE(desktop->subscribed.get());
+
+    // cleanup
+    g_clear_object(&connection);
+}
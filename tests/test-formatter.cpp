@@ -21,6 +21,7 @@
 #include "glib-fixture.h"
 
 #include <datetime/clock-mock.h>
+#include <datetime/compiled-format.h>
 #include <datetime/formatter.h>
 #include <datetime/settings.h>
 
@@ -236,3 +237,91 @@ TEST_F(FormatterFixture, DISABLED_TestEventTimes)
         }
     }
 }
+
+/**
+ * Confirm that compiled formats match g_date_time_format() tick by tick
+ */
+TEST_F(FormatterFixture, CompiledFormatMatchesGlib)
+{
+    const char* formats[] = {
+        "%H:%M", "%l:%M %p", "%H:%M:%S", "%l:%M:%S %p", "%a %b %e %H:%M",
+        "%a %d %b %Y %T", "%A %x %X", "%-d %B %y, %I:%M %P", "100%% %j %Z%n%t", ""
+    };
+
+    for (const auto& locale : { "C", "en_US.utf8" })
+    {
+        if (!SetLocale(locale, locale))
+            continue;
+
+        for (const auto& fmt : formats)
+        {
+            CompiledFormat compiled(fmt);
+
+            // tick over seconds, minutes, hours, days, and a year boundary
+            auto now = DateTime::Local(2015, 12, 31, 11, 58, 57);
+            for (int i=0; i<200; ++i)
+            {
+                EXPECT_EQ(now.format(fmt), compiled.format(now)) << fmt << ' ' << i;
+                now = now.add_full(0, 0, 0, 0, 0, i<100 ? 1 : 3677);
+            }
+        }
+    }
+}
+
+/**
+ * Confirm that a compiled format notices locale and timezone changes
+ * that don't change any of the fields' values
+ */
+TEST_F(FormatterFixture, CompiledFormatFollowsLocaleAndTimezone)
+{
+    const std::string fmt {"%a %b %e %l:%M %p %Z"};
+    CompiledFormat compiled(fmt);
+
+    auto now = DateTime::Local(2015, 1, 10, 13, 35, 0);
+    for (const auto& locale : { "C", "fr_FR.utf8", "de_DE.utf8", "C" })
+        if (SetLocale(locale, locale))
+            EXPECT_EQ(now.format(fmt), compiled.format(now)) << locale;
+
+    // same utc offset, different abbreviations
+    for (const auto& zone : { "Europe/Paris", "Africa/Lagos" })
+    {
+        auto gtz = g_time_zone_new(zone);
+        now = DateTime(gtz, 2015, 1, 10, 13, 35, 0);
+        EXPECT_EQ(now.format(fmt), compiled.format(now)) << zone;
+        g_time_zone_unref(gtz);
+    }
+}
+
+/**
+ * Compare the per-tick cost of the header's compiled format against
+ * reformatting the whole string
+ */
+TEST_F(FormatterFixture, CompiledFormatBenchmark)
+{
+    static constexpr int N_TICKS {10000};
+    const std::string fmt {"%a %b %e %l:%M:%S %p"};
+
+    std::vector<DateTime> ticks;
+    auto now = DateTime::Local(2015, 4, 23, 13, 35, 0);
+    for (int i=0; i<N_TICKS; ++i)
+        ticks.push_back(now = now.add_full(0, 0, 0, 0, 0, 1));
+    for (const auto& tick : ticks)
+        tick.get(); // don't time the GDateTime creation
+
+    size_t legacy_len {0};
+    auto begin = g_get_monotonic_time();
+    for (const auto& tick : ticks)
+        legacy_len += tick.format(fmt).size();
+    const auto legacy_usec = g_get_monotonic_time() - begin;
+
+    size_t len {0};
+    CompiledFormat compiled(fmt);
+    begin = g_get_monotonic_time();
+    for (const auto& tick : ticks)
+        len += compiled.format(tick).size();
+    const auto usec = g_get_monotonic_time() - begin;
+
+    g_message("formatting '%s' for %d ticks: g_date_time_format %.1f ms, compiled %.1f ms",
+              fmt.c_str(), N_TICKS, legacy_usec/1000.0, usec/1000.0);
+    EXPECT_EQ(legacy_len, len);
+}
@@ -22,7 +22,10 @@
 
 #include <datetime/appointment.h>
 #include <datetime/menu.h>
+#include <datetime/upcoming-index.h>
 
+#include <algorithm>
+#include <random>
 #include <vector>
 
 using MenuAppointmentFixture = GlibFixture;
@@ -261,3 +264,97 @@ TEST_F(MenuAppointmentFixture, DisplayEvents)
     }
 }
 
+TEST_F(MenuAppointmentFixture, UpcomingIndexBenchmark)
+{
+    // a few thousand upcoming instances over a month:
+    // mostly hour-long events, with some full-day and multi-day ones
+    constexpr int N_APPOINTMENTS {3000};
+    constexpr int N_TICKS {24*60};
+    const auto start = DateTime::Local(2016,12,20,0,0,0);
+    std::mt19937 rng(1515821);
+    std::vector<Appointment> appointments;
+    for (int i=0; i<N_APPOINTMENTS; ++i)
+    {
+        const auto day = start.add_days(int(rng() % 30) - 2);
+        const auto kind = rng() % 10;
+        DateTime begin, end;
+        if (kind < 7) {
+            begin = day.add_full(0,0,0,rng()%24,(rng()%4)*15,0);
+            end = begin.add_full(0,0,0,1,0,0);
+        } else if (kind < 9) {
+            begin = day;
+            end = day.add_days(1);
+        } else {
+            begin = day.add_full(0,0,0,rng()%24,0,0);
+            end = begin.add_days(1 + rng()%4);
+        }
+        appointments.push_back(create_appointment(Appointment::EVENT,
+                                                  "uid-" + std::to_string(i),
+                                                  "Event " + std::to_string(i),
+                                                  begin, end));
+    }
+    const AppointmentList list(appointments);
+
+    std::vector<DateTime> ticks;
+    for (int i=0; i<N_TICKS; ++i)
+        ticks.push_back(start.add_full(0,0,0,0,i,0));
+
+    // the way it used to be done: filter, sort everything by priority, sort again for display
+    auto reference = [&appointments](const DateTime& now, unsigned int max_items) {
+        std::vector<Appointment> ret;
+        std::copy_if(appointments.begin(), appointments.end(), std::back_inserter(ret),
+                     [now](const Appointment& a){return a.end >= now;});
+        const auto next_minute = now.add_full(0,0,0,0,1,-now.seconds());
+        const auto start_of_day = now.start_of_day();
+        const auto end_of_day = now.end_of_day();
+        auto priority = [&](const Appointment& a) {
+            if ((a.begin >= next_minute) || (a.end <= end_of_day))
+                return 0;
+            if ((a.begin <= start_of_day) && (end_of_day <= a.end))
+                return 1;
+            return 2;
+        };
+        std::sort(ret.begin(), ret.end(), [&](const Appointment& a, const Appointment& b){
+            const auto pa = priority(a);
+            const auto pb = priority(b);
+            if (pa != pb)
+                return pa < pb;
+            if (a.begin != b.begin)
+                return a.begin < b.begin;
+            if (a.end != b.end)
+                return a.end < b.end;
+            return a.summary < b.summary;
+        });
+        if (ret.size() > max_items)
+            ret.resize(max_items);
+        std::sort(ret.begin(), ret.end(), [](const Appointment& a, const Appointment& b){
+            if (a.begin != b.begin)
+                return a.begin < b.begin;
+            if (a.end != b.end)
+                return a.end < b.end;
+            return a.summary < b.summary;
+        });
+        return ret;
+    };
+
+    std::vector<std::vector<Appointment>> expected;
+    auto begin_usec = g_get_monotonic_time();
+    for (const auto& tick : ticks)
+        expected.push_back(reference(tick, 5));
+    const auto reference_usec = g_get_monotonic_time() - begin_usec;
+
+    std::vector<std::vector<Appointment>> results;
+    UpcomingIndex index;
+    begin_usec = g_get_monotonic_time();
+    for (const auto& tick : ticks)
+    {
+        index.set(list);
+        results.push_back(index.get_display_appointments(tick, 5));
+    }
+    const auto index_usec = g_get_monotonic_time() - begin_usec;
+
+    g_message("%d appointments, %d ticks: full sort %.1f ms, index %.1f ms",
+              N_APPOINTMENTS, N_TICKS, reference_usec/1000.0, index_usec/1000.0);
+    for (int i=0; i<N_TICKS; ++i)
+        ASSERT_EQ(expected[i], results[i]) << "tick " << i;
+}
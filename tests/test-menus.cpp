@@ -30,6 +30,47 @@
 
 using namespace unity::indicator::datetime;
 
+namespace
+{
+    struct ItemsChanged
+    {
+        int n_signals = 0;
+        int n_removed = 0;
+        int n_added = 0;
+        gsize n_bytes = 0; // roughly what an exporter would send for the added items
+    };
+
+    gsize get_item_size(GMenuModel* model, int i)
+    {
+        GVariantBuilder b;
+        g_variant_builder_init(&b, G_VARIANT_TYPE_VARDICT);
+        const char* name;
+        GVariant* value;
+        auto iter = g_menu_model_iterate_item_attributes(model, i);
+        while (g_menu_attribute_iter_get_next(iter, &name, &value))
+        {
+            g_variant_builder_add(&b, "{sv}", name, value);
+            g_variant_unref(value);
+        }
+        g_object_unref(iter);
+
+        auto dict = g_variant_ref_sink(g_variant_builder_end(&b));
+        const auto size = g_variant_get_size(dict);
+        g_variant_unref(dict);
+        return size;
+    }
+
+    void on_items_changed(GMenuModel* model, gint position, gint removed, gint added, gpointer gcounts)
+    {
+        auto counts = static_cast<ItemsChanged*>(gcounts);
+        ++counts->n_signals;
+        counts->n_removed += removed;
+        counts->n_added += added;
+        for (int i=position; i<position+added; ++i)
+            counts->n_bytes += get_item_size(model, i);
+    }
+}
+
 class MenuFixture: public StateFixture
 {
 private:
@@ -509,10 +550,12 @@ TEST_F(MenuFixture, Sections)
 TEST_F(MenuFixture, Calendar)
 {
     m_state->settings->show_calendar.set(true);
+    wait_msec(); // wait a moment for the menu to update
     for(auto& menu : m_menus)
       InspectCalendar(menu->menu_model(), menu->profile());
 
     m_state->settings->show_calendar.set(false);
+    wait_msec(); // wait a moment for the menu to update
     for(auto& menu : m_menus)
       InspectCalendar(menu->menu_model(), menu->profile());
 }
@@ -542,4 +585,96 @@ TEST_F(MenuFixture, Settings)
       InspectSettings(menu->menu_model(), menu->profile());
 }
 
+TEST_F(MenuFixture, ExportsOnlyChangedItems)
+{
+    // start at noon so that the next minute is the same day
+    const auto now = m_state->clock->localtime().start_of_day().add_full(0,0,0,12,0,0);
+    m_mock_state->mock_clock->set_localtime(now);
+
+    // give the menu a full list of upcoming appointments
+    const auto tomorrow = now.add_days(1).start_of_day();
+    std::vector<Appointment> appointments;
+    for (int i=0; i<10; ++i)
+    {
+        Appointment a;
+        a.summary = "Appointment " + std::to_string(i);
+        a.uid = "uid-" + std::to_string(i);
+        a.type = Appointment::EVENT;
+        a.begin = tomorrow.add_full(0,0,0,i+8,0,0);
+        a.end = a.begin.add_full(0,0,0,0,30,0);
+        appointments.push_back(a);
+    }
+    m_state->settings->show_events.set(true);
+    m_state->calendar_upcoming->appointments().set(appointments);
+    m_state->locations->locations.set(std::vector<Location>({Location("America/Chicago", "Dallas"),
+                                                             Location("Europe/London", "London")}));
+    wait_msec();
+
+    auto& menu = m_menus[Menu::Desktop];
+    auto submenu = g_menu_model_get_item_link(menu->menu_model(), 0, G_MENU_LINK_SUBMENU);
+    auto appointments_section = g_menu_model_get_item_link(submenu, Menu::Appointments, G_MENU_LINK_SECTION);
+    auto locations_section = g_menu_model_get_item_link(submenu, Menu::Locations, G_MENU_LINK_SECTION);
+    gsize full_bytes = 0;
+    for (int i=0, n=g_menu_model_get_n_items(appointments_section); i<n; ++i)
+        full_bytes += get_item_size(appointments_section, i);
+    ASSERT_LT(0u, full_bytes);
+
+    ItemsChanged counts;
+    auto tag1 = g_signal_connect(appointments_section, "items-changed", G_CALLBACK(on_items_changed), &counts);
+    auto tag2 = g_signal_connect(locations_section, "items-changed", G_CALLBACK(on_items_changed), &counts);
+
+    // a minute passes; nothing visible changes, so nothing gets sent
+    m_mock_state->mock_clock->set_localtime(now.add_full(0,0,0,0,1,0));
+    wait_msec();
+    // the locations get rebuilt, but come out the same
+    m_state->settings->show_clock.set(!m_state->settings->show_clock.get());
+    wait_msec();
+    g_message("idle minute: %d items-changed, %d bytes", counts.n_signals, int(counts.n_bytes));
+    EXPECT_EQ(0, counts.n_signals);
+    EXPECT_EQ(0u, counts.n_bytes);
+
+    // move one appointment; only its menuitem should be sent
+    counts = ItemsChanged();
+    appointments[2].begin = appointments[2].begin.add_full(0,0,0,0,5,0);
+    appointments[2].end = appointments[2].end.add_full(0,0,0,0,5,0);
+    m_state->calendar_upcoming->appointments().set(appointments);
+    wait_msec();
+    g_message("one changed appointment: %d items-changed, %d bytes (whole section is %d bytes)",
+              counts.n_signals, int(counts.n_bytes), int(full_bytes));
+    EXPECT_EQ(1, counts.n_removed);
+    EXPECT_EQ(1, counts.n_added);
+    EXPECT_LT(counts.n_bytes, full_bytes);
+
+    g_signal_handler_disconnect(appointments_section, tag1);
+    g_signal_handler_disconnect(locations_section, tag2);
+    g_clear_object(&locations_section);
+    g_clear_object(&appointments_section);
+    g_clear_object(&submenu);
+}
 
+TEST_F(MenuFixture, CoalescesRebuilds)
+{
+    wait_msec(); // let the menus settle
+
+    auto& menu = m_menus[Menu::Desktop];
+    const auto requested = menu->rebuilds_requested();
+    const auto executed = menu->rebuilds_executed();
+
+    // a burst of changes in one main loop iteration, like at midnight
+    const auto tomorrow = m_state->clock->localtime().add_days(1).start_of_day();
+    m_mock_state->mock_clock->set_localtime(tomorrow); // Calendar + Locations
+    m_state->settings->show_clock.set(!m_state->settings->show_clock.get()); // header + Locations
+    m_state->locations->locations.set(std::vector<Location>({Location("America/Chicago", "Dallas")})); // Locations
+
+    // nothing gets rebuilt until the main loop is idle...
+    EXPECT_EQ(executed, menu->rebuilds_executed());
+    EXPECT_LE(requested + 5, menu->rebuilds_requested());
+
+    // ...and then each dirty section is rebuilt once
+    wait_msec();
+    const auto n_requested = menu->rebuilds_requested() - requested;
+    const auto n_executed = menu->rebuilds_executed() - executed;
+    g_message("%u rebuilds requested, %u executed", n_requested, n_executed);
+    EXPECT_LE(n_executed, unsigned(Menu::NUM_SECTIONS + 1)); // each section plus the header
+    EXPECT_LT(n_executed, n_requested);
+}
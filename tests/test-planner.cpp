@@ -18,12 +18,17 @@
  */
 
 #include "glib-fixture.h"
+#include "planner-mock.h"
 #include "timezone-mock.h"
 
 #include <datetime/appointment.h>
 #include <datetime/clock-mock.h>
 #include <datetime/date-time.h>
+#include <datetime/engine.h>
+#include <datetime/engine-mock.h>
 #include <datetime/planner.h>
+#include <datetime/planner-aggregate.h>
+#include <datetime/planner-month.h>
 #include <datetime/planner-range.h>
 
 #include <langinfo.h>
@@ -66,3 +71,332 @@ TEST_F(PlannerFixture, HelloWorld)
     EXPECT_EQ(d.end, a.end);
 }
 
+
+/***
+****
+***/
+
+namespace
+{
+    /**
+     * An Engine whose requests are only answered when the test says so.
+     * Like a careless engine, it answers cancelled requests too.
+     */
+    class ManualEngine: public Engine
+    {
+    public:
+        ~ManualEngine()
+        {
+            for (auto& request : requests)
+                g_clear_object(&request.cancellable);
+        }
+
+        void get_appointments(const DateTime& /*begin*/,
+                              const DateTime& /*end*/,
+                              const Timezone& /*default_timezone*/,
+                              std::function<void(const std::vector<Appointment>&)> func,
+                              GCancellable* cancellable) override {
+            requests.push_back(Request{func, cancellable ? G_CANCELLABLE(g_object_ref(cancellable)) : nullptr});
+        }
+        void disable_ubuntu_alarm(const Appointment&) override {}
+        core::Signal<>& changed() override {return m_changed;}
+
+        void complete(size_t i, const std::vector<Appointment>& appointments)
+        {
+            requests.at(i).func(appointments);
+        }
+
+        bool is_cancelled(size_t i) const
+        {
+            return g_cancellable_is_cancelled(requests.at(i).cancellable);
+        }
+
+        struct Request
+        {
+            std::function<void(const std::vector<Appointment>&)> func;
+            GCancellable* cancellable;
+        };
+        std::vector<Request> requests;
+
+    private:
+        core::Signal<> m_changed;
+    };
+}
+
+TEST_F(PlannerFixture, SupersededRequestsAreCancelled)
+{
+    static constexpr size_t N_MONTHS = 12;
+
+    auto engine = std::make_shared<ManualEngine>();
+    auto tz = std::make_shared<MockTimezone>("America/Chicago");
+    auto range_planner = std::make_shared<SimpleRangePlanner>(engine, tz);
+    const auto start = DateTime::Local(2015, 1, 15, 12, 0, 0);
+    MonthPlanner month_planner(range_planner, start);
+    ASSERT_TRUE(wait_for([&engine](){return engine->requests.size() == 1;}));
+
+    // flip through the months without letting the engine answer
+    for (size_t i=1; i<=N_MONTHS; ++i) {
+        month_planner.month().set(start.add_full(0,i,0,0,0,0));
+        ASSERT_TRUE(wait_for([&engine, i](){return engine->requests.size() == i+1;}));
+    }
+    EXPECT_EQ(start.add_full(0,N_MONTHS,0,0,0,0).start_of_month(), range_planner->range().get().first);
+
+    // every request but the last should have been cancelled
+    const auto last = engine->requests.size() - 1;
+    for (size_t i=0; i<last; ++i)
+        EXPECT_TRUE(engine->is_cancelled(i)) << i;
+    EXPECT_FALSE(engine->is_cancelled(last));
+
+    // watch for the superseded requests' results
+    auto make_appointment = [&start](const std::string& uid){
+        Appointment a;
+        a.uid = uid;
+        a.begin = start.add_full(0,N_MONTHS,0,0,0,0);
+        a.end = a.begin.add_full(0,0,0,1,0,0);
+        return std::vector<Appointment>(1, a);
+    };
+    bool saw_stale {false};
+    core::ScopedConnection connection(range_planner->appointments().changed().connect([&saw_stale](const AppointmentList& appointments){
+        for (const auto& appointment : appointments)
+            saw_stale |= appointment.uid != "fresh";
+    }));
+
+    // even if the engine answers them anyway, they shouldn't get through
+    for (size_t i=0; i<last; ++i)
+        engine->complete(i, make_appointment("stale-" + std::to_string(i)));
+    engine->complete(last, make_appointment("fresh"));
+
+    EXPECT_FALSE(saw_stale);
+    EXPECT_EQ(make_appointment("fresh"), range_planner->appointments().get());
+}
+
+/***
+****
+***/
+
+namespace
+{
+    /**
+     * An Engine with a fast local source and a slow remote one
+     */
+    class StreamingEngine: public Engine
+    {
+    public:
+        static constexpr int REMOTE_MSEC = 1000;
+
+        StreamingEngine(const Appointment& local, const Appointment& remote):
+            m_local(local), m_remote(remote) {}
+
+        void get_appointments(const DateTime& begin,
+                              const DateTime& end,
+                              const Timezone& tz,
+                              std::function<void(const std::vector<Appointment>&)> func,
+                              GCancellable* cancellable) override {
+            stream_appointments(begin, end, tz, [func](const std::vector<Appointment>& a, bool done){
+                if (done)
+                    func(a);
+            }, cancellable);
+        }
+        void stream_appointments(const DateTime& /*begin*/,
+                                 const DateTime& /*end*/,
+                                 const Timezone& /*default_timezone*/,
+                                 std::function<void(const std::vector<Appointment>&, bool)> func,
+                                 GCancellable* /*cancellable*/) override {
+            func(std::vector<Appointment>(1, m_local), false);
+            m_pending = func;
+            g_timeout_add(REMOTE_MSEC, on_remote_ready, this);
+        }
+        void disable_ubuntu_alarm(const Appointment&) override {}
+        core::Signal<>& changed() override {return m_changed;}
+
+    private:
+        static gboolean on_remote_ready(gpointer gself)
+        {
+            auto self = static_cast<StreamingEngine*>(gself);
+            self->m_pending(std::vector<Appointment>(1, self->m_remote), false);
+            self->m_pending(std::vector<Appointment>{self->m_local, self->m_remote}, true);
+            return G_SOURCE_REMOVE;
+        }
+
+        const Appointment m_local;
+        const Appointment m_remote;
+        std::function<void(const std::vector<Appointment>&, bool)> m_pending;
+        core::Signal<> m_changed;
+    };
+}
+
+TEST_F(PlannerFixture, PartialResultsArriveEarly)
+{
+    const auto start = DateTime::Local(2015, 1, 15, 12, 0, 0);
+
+    Appointment local;
+    local.uid = "local";
+    local.begin = start.add_full(0,0,1,0,0,0);
+    local.end = local.begin.add_full(0,0,0,1,0,0);
+    Appointment remote;
+    remote.uid = "remote";
+    remote.begin = start.add_full(0,0,2,0,0,0);
+    remote.end = remote.begin.add_full(0,0,0,1,0,0);
+
+    auto engine = std::make_shared<StreamingEngine>(local, remote);
+    auto tz = std::make_shared<MockTimezone>("America/Chicago");
+    auto range_planner = std::make_shared<SimpleRangePlanner>(engine, tz);
+    MonthPlanner month_planner(range_planner, start);
+
+    // the local source shouldn't have to wait for the remote one...
+    wait_msec(StreamingEngine::REMOTE_MSEC / 2);
+    EXPECT_EQ(std::vector<Appointment>(1, local), month_planner.appointments().get());
+
+    // ...which gets merged in when it's ready
+    wait_msec(StreamingEngine::REMOTE_MSEC);
+    const std::vector<Appointment> expected {local, remote};
+    EXPECT_EQ(expected, month_planner.appointments().get());
+}
+
+TEST_F(PlannerFixture, FindAppointmentByUid)
+{
+    auto engine = std::make_shared<MockEngine>();
+    auto tz = std::make_shared<MockTimezone>("America/Chicago");
+    auto range_planner = std::make_shared<SimpleRangePlanner>(engine, tz);
+
+    const auto start = DateTime::Local(2015, 1, 15, 12, 0, 0);
+    std::vector<Appointment> appointments;
+    for (int i=0; i<3; ++i) {
+        Appointment a;
+        a.uid = i==2 ? "b" : "a"; // "a" recurs
+        a.begin = start.add_days(i);
+        a.end = a.begin.add_full(0,0,0,1,0,0);
+        appointments.push_back(a);
+    }
+    range_planner->appointments().set(appointments);
+
+    Appointment found;
+    EXPECT_TRUE(range_planner->find_appointment("a", found));
+    EXPECT_EQ(appointments[0], found); // the earliest instance
+    EXPECT_TRUE(range_planner->find_appointment("b", found));
+    EXPECT_EQ(appointments[2], found);
+    EXPECT_FALSE(range_planner->find_appointment("c", found));
+
+    // the index follows changes to the planner
+    appointments.erase(appointments.begin());
+    range_planner->appointments().set(appointments);
+    EXPECT_TRUE(range_planner->find_appointment("a", found));
+    EXPECT_EQ(appointments[0], found);
+    appointments.pop_back();
+    range_planner->appointments().set(appointments);
+    EXPECT_FALSE(range_planner->find_appointment("b", found));
+}
+
+TEST_F(PlannerFixture, Deltas)
+{
+    auto planner = std::make_shared<MockRangePlanner>();
+
+    const auto start = DateTime::Local(2015, 1, 15, 12, 0, 0);
+    std::vector<Appointment> appointments;
+    for (int i=0; i<4; ++i) {
+        Appointment a;
+        a.uid = i<2 ? "recurring" : "single-" + std::to_string(i);
+        a.summary = "Summary";
+        a.begin = start.add_days(i);
+        a.end = a.begin.add_full(0,0,0,1,0,0);
+        appointments.push_back(a);
+    }
+    planner->appointments().set(appointments);
+
+    std::vector<AppointmentDelta> deltas;
+    planner->deltas().connect([&deltas](const AppointmentDelta& delta){
+        deltas.push_back(delta);
+    });
+
+    // drop one instance of the recurring event, edit one, and add a new one
+    auto changed = appointments;
+    const auto removed = changed[1];
+    changed.erase(changed.begin()+1);
+    changed[1].summary = "New Summary";
+    Appointment added;
+    added.uid = "new";
+    added.begin = start.add_days(7);
+    added.end = added.begin.add_full(0,0,0,1,0,0);
+    changed.push_back(added);
+    planner->appointments().set(changed);
+
+    ASSERT_EQ(1u, deltas.size());
+    EXPECT_EQ(std::vector<Appointment>(1, added), deltas[0].added);
+    EXPECT_EQ(std::vector<Appointment>(1, removed), deltas[0].removed);
+    EXPECT_EQ(std::vector<Appointment>(1, changed[1]), deltas[0].changed);
+
+    // no news is no delta
+    planner->appointments().set(std::vector<Appointment>(changed));
+    EXPECT_EQ(1u, deltas.size());
+}
+
+TEST_F(PlannerFixture, AggregateMergesSortedChildren)
+{
+    const auto start = DateTime::Local(2015, 1, 15, 12, 0, 0);
+    auto make = [start](const std::string& uid, int hours){
+        Appointment a;
+        a.uid = uid;
+        a.begin = start.add_full(0,0,0,hours,0,0);
+        a.end = a.begin.add_full(0,0,0,1,0,0);
+        return a;
+    };
+
+    auto a = std::make_shared<MockRangePlanner>();
+    auto b = std::make_shared<MockRangePlanner>();
+    AggregatePlanner aggregate;
+    aggregate.add(a);
+    aggregate.add(b);
+
+    // with only one child populated, its list is shared
+    a->appointments().set(std::vector<Appointment>{make("a0",0), make("a2",2), make("a4",4)});
+    EXPECT_EQ(a->appointments().get().snapshot(), aggregate.appointments().get().snapshot());
+
+    // the children's lists are interleaved
+    b->appointments().set(std::vector<Appointment>{make("b1",1), make("b3",3)});
+    std::vector<std::string> uids;
+    for (const auto& appt : aggregate.appointments().get())
+        uids.push_back(appt.uid);
+    EXPECT_EQ((std::vector<std::string>{"a0","b1","a2","b3","a4"}), uids);
+
+    // changing one child replaces only its slice
+    a->appointments().set(std::vector<Appointment>{make("a5",5)});
+    uids.clear();
+    for (const auto& appt : aggregate.appointments().get())
+        uids.push_back(appt.uid);
+    EXPECT_EQ((std::vector<std::string>{"b1","b3","a5"}), uids);
+
+    b->appointments().set(std::vector<Appointment>());
+    EXPECT_EQ(a->appointments().get().snapshot(), aggregate.appointments().get().snapshot());
+}
+
+TEST_F(PlannerFixture, MonthAppointmentDays)
+{
+    auto range_planner = std::make_shared<MockRangePlanner>();
+    MonthPlanner month(range_planner, DateTime::Local(2015, 1, 15, 12, 0, 0));
+    EXPECT_TRUE(month.appointment_days().get().empty());
+
+    auto make = [](const std::string& uid, const DateTime& begin, const DateTime& end){
+        Appointment a;
+        a.uid = uid;
+        a.begin = begin;
+        a.end = end;
+        return a;
+    };
+    const auto meeting = make("meeting", DateTime::Local(2015,1,5,10,0,0), DateTime::Local(2015,1,5,11,0,0));
+    const auto holiday = make("holiday", DateTime::Local(2015,1,20,0,0,0), DateTime::Local(2015,1,23,0,0,0)); // ends at midnight
+    const auto trip = make("trip", DateTime::Local(2014,12,30,9,0,0), DateTime::Local(2015,1,2,17,0,0)); // starts last month
+    range_planner->appointments().set(std::vector<Appointment>{trip, meeting, holiday});
+
+    // multi-day events mark every day they cover in this month
+    EXPECT_EQ((std::vector<int>{1,2,5,20,21,22}), month.appointment_days().get());
+
+    // shorten the holiday and drop the meeting
+    auto shorter = holiday;
+    shorter.end = DateTime::Local(2015,1,21,0,0,0);
+    range_planner->appointments().set(std::vector<Appointment>{trip, shorter});
+    EXPECT_EQ((std::vector<int>{1,2,20}), month.appointment_days().get());
+
+    // moving to the previous month reuses what's indexed: the trip covers its end
+    month.month().set(DateTime::Local(2014,12,1,0,0,0));
+    EXPECT_EQ((std::vector<int>{30,31}), month.appointment_days().get());
+}
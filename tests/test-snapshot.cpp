@@ -0,0 +1,181 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include "glib-fixture.h"
+
+#include <datetime/snapshot.h>
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+class SnapshotFixture: public GlibFixture
+{
+private:
+    typedef GlibFixture super;
+
+protected:
+    std::string m_filename;
+
+    void SetUp() override
+    {
+        super::SetUp();
+
+        m_filename = SANDBOX "/test-snapshot/appointments.snapshot";
+        g_remove(m_filename.c_str());
+    }
+
+    void TearDown() override
+    {
+        g_remove(m_filename.c_str());
+
+        super::TearDown();
+    }
+
+    static Appointment create_appointment(const std::string& uid, const DateTime& begin)
+    {
+        Appointment a;
+        a.uid = uid;
+        a.source_uid = "source";
+        a.color = "red";
+        a.summary = "Summary of " + uid;
+        a.activation_url = "appid://com.ubuntu.calendar";
+        a.begin = begin;
+        a.end = begin.add_full(0,0,0,1,0,0);
+        return a;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(SnapshotFixture, MissingFile)
+{
+    Snapshot snapshot(m_filename);
+    std::vector<Appointment> upcoming, month;
+    EXPECT_FALSE(snapshot.load(DateTime::NowLocal(), upcoming, month));
+    EXPECT_TRUE(upcoming.empty());
+    EXPECT_TRUE(month.empty());
+}
+
+TEST_F(SnapshotFixture, RoundTrip)
+{
+    const auto now = DateTime::Local(2015, 6, 10, 12, 0, 0);
+
+    std::vector<Appointment> upcoming;
+    upcoming.push_back(create_appointment("a", now.add_full(0,0,0,1,0,0)));
+    upcoming.push_back(create_appointment("b", now.add_days(2)));
+    upcoming[1].type = Appointment::UBUNTU_ALARM;
+    upcoming[1].color.clear();
+    std::vector<Appointment> month = upcoming;
+    month.push_back(create_appointment("c", now.start_of_month()));
+
+    Snapshot snapshot(m_filename);
+    snapshot.save(now.start_of_month(), upcoming, month);
+
+    std::vector<Appointment> upcoming_out, month_out;
+    ASSERT_TRUE(snapshot.load(now, upcoming_out, month_out));
+
+    ASSERT_EQ(upcoming.size(), upcoming_out.size());
+    for (size_t i=0; i<upcoming.size(); ++i) {
+        EXPECT_EQ(upcoming[i].uid, upcoming_out[i].uid);
+        EXPECT_EQ(upcoming[i].source_uid, upcoming_out[i].source_uid);
+        EXPECT_EQ(upcoming[i].color, upcoming_out[i].color);
+        EXPECT_EQ(upcoming[i].summary, upcoming_out[i].summary);
+        EXPECT_EQ(upcoming[i].activation_url, upcoming_out[i].activation_url);
+        EXPECT_EQ(upcoming[i].type, upcoming_out[i].type);
+        EXPECT_EQ(upcoming[i].begin, upcoming_out[i].begin);
+        EXPECT_EQ(upcoming[i].end, upcoming_out[i].end);
+    }
+
+    // the month only keeps the dates
+    ASSERT_EQ(month.size(), month_out.size());
+    for (size_t i=0; i<month.size(); ++i) {
+        EXPECT_EQ(month[i].begin, month_out[i].begin);
+        EXPECT_EQ(month[i].end, month_out[i].end);
+    }
+}
+
+TEST_F(SnapshotFixture, KeepsUtcOffsets)
+{
+    const auto now = DateTime::Local(2015, 6, 10, 12, 0, 0);
+
+    // an appointment that wasn't made in the local timezone
+    auto gtz = g_time_zone_new("+09:30");
+    std::vector<Appointment> upcoming;
+    upcoming.push_back(create_appointment("a", DateTime(gtz, 2015, 6, 10, 18, 0, 0)));
+    upcoming.push_back(create_appointment("b", now.add_days(1)));
+    g_time_zone_unref(gtz);
+
+    Snapshot snapshot(m_filename);
+    snapshot.save(now.start_of_month(), upcoming, upcoming);
+
+    std::vector<Appointment> upcoming_out, month_out;
+    ASSERT_TRUE(snapshot.load(now, upcoming_out, month_out));
+    ASSERT_EQ(upcoming.size(), upcoming_out.size());
+    for (size_t i=0; i<upcoming.size(); ++i) {
+        EXPECT_EQ(upcoming[i].begin, upcoming_out[i].begin);
+        EXPECT_EQ(upcoming[i].begin.utc_offset(), upcoming_out[i].begin.utc_offset());
+        EXPECT_EQ(upcoming[i].begin.format("%F %T"), upcoming_out[i].begin.format("%F %T"));
+        EXPECT_EQ(upcoming[i].end.utc_offset(), upcoming_out[i].end.utc_offset());
+    }
+}
+
+TEST_F(SnapshotFixture, SkipsStaleAppointments)
+{
+    const auto then = DateTime::Local(2015, 6, 10, 12, 0, 0);
+
+    std::vector<Appointment> upcoming;
+    upcoming.push_back(create_appointment("a", then));
+    upcoming.push_back(create_appointment("b", then.add_full(0,1,0,0,0,0)));
+
+    Snapshot snapshot(m_filename);
+    snapshot.save(then.start_of_month(), upcoming, upcoming);
+
+    // a month later, only 'b' is upcoming and last month's calendar is stale
+    std::vector<Appointment> upcoming_out, month_out;
+    ASSERT_TRUE(snapshot.load(then.add_full(0,1,0,0,0,0), upcoming_out, month_out));
+    ASSERT_EQ(1, upcoming_out.size());
+    EXPECT_EQ("b", upcoming_out[0].uid);
+    EXPECT_TRUE(month_out.empty());
+}
+
+TEST_F(SnapshotFixture, RejectsCorruptFiles)
+{
+    const auto now = DateTime::Local(2015, 6, 10, 12, 0, 0);
+    std::vector<Appointment> upcoming;
+    upcoming.push_back(create_appointment("a", now));
+
+    Snapshot snapshot(m_filename);
+    snapshot.save(now.start_of_month(), upcoming, upcoming);
+
+    // truncate the file
+    gchar* contents {};
+    gsize length {};
+    ASSERT_TRUE(g_file_get_contents(m_filename.c_str(), &contents, &length, nullptr));
+    ASSERT_TRUE(g_file_set_contents(m_filename.c_str(), contents, length-1, nullptr));
+    g_free(contents);
+
+    std::vector<Appointment> upcoming_out, month_out;
+    EXPECT_FALSE(snapshot.load(now, upcoming_out, month_out));
+    EXPECT_TRUE(upcoming_out.empty());
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/timer-service.h>
+
+#include "glib-fixture.h"
+
+#include <vector>
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+class TimerServiceFixture: public GlibFixture
+{
+private:
+
+    typedef GlibFixture super;
+
+protected:
+
+    std::vector<int> m_kicked;
+
+    void SetUp() override
+    {
+        super::SetUp();
+
+        m_kicked.clear();
+    }
+
+    TimerService::Func kick(int i)
+    {
+        return [this, i](){m_kicked.push_back(i);};
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(TimerServiceFixture, OverlappingTimersShareOneWakeup)
+{
+    TimerService service;
+    constexpr GTimeSpan msec {G_TIME_SPAN_MILLISECOND};
+
+    // each deadline falls inside the first timer's window
+    service.add(20*msec, 50*msec, kick(0));
+    service.add(30*msec, 50*msec, kick(1));
+    service.add(40*msec, 50*msec, kick(2));
+    wait_msec(200);
+
+    EXPECT_EQ(std::vector<int>({0, 1, 2}), m_kicked);
+    EXPECT_EQ(1u, service.wakeup_count());
+}
+
+TEST_F(TimerServiceFixture, StrictTimersWakeSeparately)
+{
+    TimerService service;
+    constexpr GTimeSpan msec {G_TIME_SPAN_MILLISECOND};
+
+    service.add(20*msec, 0, kick(0));
+    service.add(60*msec, 0, kick(1));
+    wait_msec(200);
+
+    EXPECT_EQ(std::vector<int>({0, 1}), m_kicked);
+    EXPECT_EQ(2u, service.wakeup_count());
+    EXPECT_LT(0, service.wakeups_per_hour());
+}
+
+TEST_F(TimerServiceFixture, NoKickBeforeDeadline)
+{
+    TimerService service;
+    constexpr GTimeSpan msec {G_TIME_SPAN_MILLISECOND};
+
+    // a strict timer shouldn't drag a later one along with it
+    service.add(20*msec, 0, kick(0));
+    service.add(100*msec, 50*msec, kick(1));
+    wait_msec(50);
+    EXPECT_EQ(std::vector<int>({0}), m_kicked);
+
+    wait_msec(200);
+    EXPECT_EQ(std::vector<int>({0, 1}), m_kicked);
+}
+
+TEST_F(TimerServiceFixture, Remove)
+{
+    TimerService service;
+    constexpr GTimeSpan msec {G_TIME_SPAN_MILLISECOND};
+
+    service.add(20*msec, 0, kick(0));
+    auto tag = service.add(30*msec, 0, kick(1));
+    service.remove(tag);
+    EXPECT_EQ(0u, tag);
+    wait_msec(100);
+
+    EXPECT_EQ(std::vector<int>({0}), m_kicked);
+    EXPECT_EQ(1u, service.wakeup_count());
+}
@@ -22,6 +22,8 @@
 
 #include <gtest/gtest.h>
 
+#include <locale.h>
+
 TEST(UtilsTest, SplitSettingsLocation)
 {
     struct {
@@ -96,3 +98,58 @@ TEST(UtilsTest, GetTimezonename)
 
     g_clear_object(&settings);
 }
+
+
+TEST(UtilsTest, TranslationsAreCached)
+{
+    const std::string original_time_locale = setlocale(LC_TIME, nullptr);
+    const std::string original_message_locale = setlocale(LC_MESSAGES, nullptr);
+    g_setenv("LANGUAGE", "xx", true);
+
+    setlocale(LC_TIME, "C");
+    const char* today = T_("Today");
+    EXPECT_STREQ("Today", today);
+    EXPECT_EQ(today, T_("Today")); // same answer from the table
+
+    // the other locale settings are left alone
+    EXPECT_EQ(original_message_locale, setlocale(LC_MESSAGES, nullptr));
+    EXPECT_STREQ("xx", g_getenv("LANGUAGE"));
+
+    // changing LC_TIME starts a new table, but old answers stay valid
+    if (setlocale(LC_TIME, "en_US.utf8") != nullptr)
+    {
+        EXPECT_STREQ("Today", T_("Today"));
+        EXPECT_STREQ("Today", today);
+    }
+
+    setlocale(LC_TIME, original_time_locale.c_str());
+    g_unsetenv("LANGUAGE");
+}
+
+
+TEST(UtilsTest, RelativeFormatFromDayNumbers)
+{
+    const std::string original_time_locale = setlocale(LC_TIME, nullptr);
+    setlocale(LC_TIME, "C"); // 24h
+
+    const gint64 day = 16000;
+    const gint64 now = day * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR;
+    auto fmt = [now, day](gint64 days_away, gint64 usec_away, gboolean full_day) {
+        return get_relative_format_string(now, day, now + usec_away, day + days_away, full_day);
+    };
+
+    EXPECT_STREQ("%H:%M", fmt(0, G_TIME_SPAN_HOUR, false));
+    EXPECT_STREQ("Tomorrow %H:%M", fmt(1, G_TIME_SPAN_DAY, false));
+    EXPECT_STREQ("%a %H:%M", fmt(6, 6*G_TIME_SPAN_DAY, false));
+    EXPECT_STREQ("%a %d %b %H:%M", fmt(7, 7*G_TIME_SPAN_DAY, false));
+    EXPECT_STREQ("%a %d %b %H:%M", fmt(0, -G_TIME_SPAN_HOUR, false)); // already happened
+    EXPECT_STREQ("Today", fmt(0, 0, true));
+    EXPECT_STREQ("Tomorrow", fmt(1, G_TIME_SPAN_DAY, true));
+    EXPECT_STREQ("%A", fmt(3, 3*G_TIME_SPAN_DAY, true));
+    EXPECT_STREQ("%a %d %b", fmt(30, 30*G_TIME_SPAN_DAY, true));
+
+    // the answers are memoized
+    EXPECT_EQ(fmt(0, G_TIME_SPAN_HOUR, false), fmt(0, 2*G_TIME_SPAN_HOUR, false));
+
+    setlocale(LC_TIME, original_time_locale.c_str());
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2014 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/clock-mock.h>
+#include <datetime/wakeup-timer-mainloop.h>
+#include <datetime/wakeup-timer-timerfd.h>
+
+#include "glib-fixture.h"
+
+#include <algorithm> // std::sort()
+#include <cstdlib> // std::abs()
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+class WakeupTimerFixture: public GlibFixture
+{
+private:
+
+    typedef GlibFixture super;
+
+protected:
+
+    static constexpr int N_SAMPLES {20};
+
+    std::shared_ptr<MockClock> m_mock_clock;
+    std::shared_ptr<Clock> m_clock;
+
+    void SetUp() override
+    {
+        super::SetUp();
+
+        m_mock_clock = std::make_shared<MockClock>(DateTime::NowLocal());
+        m_clock = std::dynamic_pointer_cast<Clock>(m_mock_clock);
+    }
+
+    void TearDown() override
+    {
+        m_clock.reset();
+        m_mock_clock.reset();
+
+        super::TearDown();
+    }
+
+    static GTimeSpan to_usec(const DateTime& dt)
+    {
+        auto gdt = dt.get();
+        return g_date_time_to_unix(gdt)*G_USEC_PER_SEC + g_date_time_get_microsecond(gdt);
+    }
+
+    // arm the timer for deadlines a few odd milliseconds away,
+    // and return how far from each deadline the timeout fired
+    std::vector<GTimeSpan> measure_latencies(WakeupTimer& timer)
+    {
+        std::vector<GTimeSpan> latencies;
+
+        for (int i=0; i<N_SAMPLES; ++i)
+        {
+            m_mock_clock->set_localtime_quietly(DateTime::NowLocal());
+            const auto deadline = m_clock->localtime().add_full(0, 0, 0, 0, 0, 0.020 + 0.0037*i);
+
+            GTimeSpan fired_at {};
+            core::ScopedConnection connection(timer.timeout().connect([this, &fired_at](){
+                fired_at = g_get_real_time();
+                g_main_loop_quit(loop);
+            }));
+            timer.set_wakeup_time(deadline);
+            wait_msec(1000);
+
+            EXPECT_NE(0, fired_at);
+            latencies.push_back(fired_at - to_usec(deadline));
+        }
+
+        return latencies;
+    }
+
+    static void print_histogram(const char* name, const std::vector<GTimeSpan>& latencies)
+    {
+        static constexpr GTimeSpan bounds_usec[] = { 500, 1000, 2000, 5000, 10000, 50000 };
+        static constexpr int n_bounds = G_N_ELEMENTS(bounds_usec);
+        int counts[n_bounds+1] = {};
+        for (const auto& latency : latencies)
+        {
+            int i = 0;
+            while ((i<n_bounds) && (std::abs(latency) >= bounds_usec[i]))
+                ++i;
+            ++counts[i];
+        }
+
+        g_message("%s latency over %zu wakeups:", name, latencies.size());
+        for (int i=0; i<n_bounds; ++i)
+            g_message("  < %6.1f msec: %d", bounds_usec[i]/1000.0, counts[i]);
+        g_message("  >=%6.1f msec: %d", bounds_usec[n_bounds-1]/1000.0, counts[n_bounds]);
+    }
+
+    static GTimeSpan median(std::vector<GTimeSpan> latencies)
+    {
+        for (auto& latency : latencies)
+            latency = std::abs(latency);
+        std::sort(latencies.begin(), latencies.end());
+        return latencies[latencies.size()/2];
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(WakeupTimerFixture, TimerfdKicksOnTime)
+{
+    TimerfdWakeupTimer timer(m_clock);
+    const auto latencies = measure_latencies(timer);
+    print_histogram("timerfd", latencies);
+
+    // it should never kick early, and should be within milliseconds
+    for (const auto& latency : latencies)
+    {
+        EXPECT_LE(0, latency);
+        EXPECT_GT(50000, latency);
+    }
+    EXPECT_GT(5000, median(latencies));
+}
+
+TEST_F(WakeupTimerFixture, MainloopForComparison)
+{
+    MainloopWakeupTimer timer(m_clock);
+    const auto latencies = measure_latencies(timer);
+    print_histogram("mainloop", latencies);
+}